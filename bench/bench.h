@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// best wall time of reps runs of call() in milliseconds
+template<typename exec_T>
+double time_ms(const exec_T& call, const int reps = 1) {
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < reps; i++) {
+        auto begin = std::chrono::steady_clock::now();
+        call();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - begin).count());
+    }
+
+    return best;
+}
+
+// the image sizes given on the command line or the defaults
+inline std::vector<int> sizes(const int argc, char** argv, const std::vector<int>& defaults) {
+    std::vector<int> result;
+    for (int i = 1; i < argc; i++) {
+        result.push_back(std::atoi(argv[i]));
+    }
+
+    return result.empty() ? defaults : result;
+}
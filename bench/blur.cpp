@@ -0,0 +1,69 @@
+#include <cstdio>
+
+#include "bench.h"
+#include "helper.h"
+
+namespace {
+
+// the 2D 3x3 blur add_gaussian_blur started from, it leaves the first and last row at 0
+void reference_blur(image<float>& img) {
+    image<float> copy(img.width(), img.height(), 0.0);
+    std::vector<int> kernel = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+
+    for (int j = 1; j < static_cast<int>(copy.height()) - 1; j++) {
+        for (int i = 0; i < copy.width(); i++) {
+            int i_is_first = static_cast<int>(i == 0);
+            int i_is_last = static_cast<int>(i == copy.width() - 1);
+
+            int w = 0;
+            float factor = 0.0;
+            for (int kj = -1; kj <= 1; kj++) {
+                w += i_is_first;
+                for (int ki = -1 + i_is_first; ki <= 1 - i_is_last; ki++) {
+                    copy.at(i, j) += img.at(i + ki, j + kj) * kernel[w];
+                    factor += kernel[w];
+                    w++;
+                }
+                w += i_is_last;
+            }
+            copy.at(i, j) /= factor;
+        }
+    }
+
+    img = std::move(copy);
+}
+
+}
+
+// the single 3x3 blur against the 2D kernel it replaced, and the multi-iteration blur against
+// looping the single one
+int main(int argc, char** argv) {
+    for (auto size : sizes(argc, argv, {512, 4096, 10000})) {
+        image<float> img(size, size, image_init::uninitialized);
+        random_stream stream(size);
+        img.for_each_pixel([&](float& p) {
+            p = uniform_float(stream(), 0.0f, 1.0f);
+        });
+        int reps = size <= 1024 ? 20 : 1;
+
+        auto reference = time_ms([&]() {
+            reference_blur(img);
+        }, reps);
+        auto single = time_ms([&]() {
+            add_gaussian_blur(img);
+        }, reps);
+        std::printf("%d^2 single blur: 2D kernel %.2f ms, separable %.2f ms\n", size, reference, single);
+
+        for (int n : {20, 25, 32, 100}) {
+            auto loop = time_ms([&]() {
+                for (int i = 0; i < n; i++) {
+                    add_gaussian_blur(img);
+                }
+            }, reps);
+            auto one_pass = time_ms([&]() {
+                add_gaussian_blur(img, n);
+            }, reps);
+            std::printf("  %d iterations: loop %.2f ms, add_gaussian_blur(img, %d) %.2f ms\n", n, loop, n, one_pass);
+        }
+    }
+}
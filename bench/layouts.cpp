@@ -0,0 +1,38 @@
+#include <cstdio>
+
+#include "bench.h"
+#include "helper.h"
+
+// the blur and the ocean distance map on a row-major and on a tiled image of the same pixels
+int main(int argc, char** argv) {
+    for (auto size : sizes(argc, argv, {1024, 4096, 10000})) {
+        image<float> rows(size, size, image_init::uninitialized);
+        rows.for_each_pixel([](float& p, size_t x, size_t y) {
+            p = ((x * 7 + y * 13) % 97) / 97.0f;
+        });
+        auto tiles = rows.to_layout<tiled_layout<>>();
+
+        auto blur_rows = time_ms([&]() {
+            add_gaussian_blur(rows);
+        }, 3);
+        auto blur_tiles = time_ms([&]() {
+            add_gaussian_blur(tiles);
+        }, 3);
+
+        // a land mask with a sparse grid of ocean pixels
+        image<float> mask(size, size, 1.0f);
+        for (int i = 0; i < size; i += 97) {
+            mask.at(i, (i * 31) % size) = 0.0f;
+        }
+        auto mask_tiles = mask.to_layout<tiled_layout<>>();
+
+        auto distance_rows = time_ms([&]() {
+            generate_ocean_distance_map(mask);
+        });
+        auto distance_tiles = time_ms([&]() {
+            generate_ocean_distance_map(mask_tiles);
+        });
+
+        std::printf("%d^2 blur: rows %.2f ms, tiles %.2f ms, distance map: rows %.2f ms, tiles %.2f ms\n", size, blur_rows, blur_tiles, distance_rows, distance_tiles);
+    }
+}
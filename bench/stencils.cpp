@@ -0,0 +1,81 @@
+#include <cmath>
+#include <cstdio>
+
+#include "bench.h"
+#include "helper.h"
+#include "generators/shapes.h"
+#include "generators/terrain.h"
+#include "generators/water.h"
+
+using namespace mapgen::generators;
+
+// per pixel cost of the stencil kernels that read their neighbours through a halo, next to the
+// same 4-neighbour sum once through the checked get() and once through neighbor_offset()
+int main(int argc, char** argv) {
+    for (auto size : sizes(argc, argv, {1024})) {
+        double pixels = static_cast<double>(size) * size;
+        auto per_pixel = [&](const double ms) {
+            return ms * 1e6 / pixels;
+        };
+
+        // a cone with some ripples, cut off to 0 near the border
+        image<float> height(size, size, image_init::uninitialized);
+        height.for_each_pixel([&](float& p, size_t x, size_t y) {
+            float dx = x - size / 2.0f;
+            float dy = y - size / 2.0f;
+            float r = std::sqrt(dx * dx + dy * dy) / (size / 2.0f);
+            p = std::max(0.0f, 1.0f - r) + 0.05f * std::sin(x * 0.1f) * std::cos(y * 0.13f);
+            if (p < 0.02f) {
+                p = 0.0f;
+            }
+        });
+
+        image<float> checked_sum(size, size);
+        auto checked = time_ms([&]() {
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    float sum = 0.0f;
+                    for (auto [dx, dy] : {std::pair{-1, 0}, {1, 0}, {0, -1}, {0, 1}}) {
+                        if (auto p = std::as_const(height).get(x + dx, y + dy)) {
+                            sum += **p;
+                        }
+                    }
+                    checked_sum.at(x, y) = sum;
+                }
+            }
+        }, 3);
+
+        image<float> padded(size, size, 0.0f, 1, 0.0f);
+        height.copy_to(padded);
+        image<float> halo_sum(size, size);
+        auto halo = time_ms([&]() {
+            const auto& src = std::as_const(padded);
+            std::ptrdiff_t offsets[] = {src.neighbor_offset(-1, 0), src.neighbor_offset(1, 0), src.neighbor_offset(0, -1), src.neighbor_offset(0, 1)};
+            for (int y = 0; y < size; y++) {
+                auto dest = halo_sum.row(y);
+                for (int x = 0; x < size; x++) {
+                    const float* p = src.pointer(x, y);
+                    dest[x] = ((p[offsets[0]] + p[offsets[1]]) + p[offsets[2]]) + p[offsets[3]];
+                }
+            }
+        }, 3);
+
+        std::printf("%d^2 ns per pixel: 4-neighbour sum get() %.2f, halo %.2f\n", size, per_pixel(checked), per_pixel(halo));
+        std::printf("  find_paths %.1f\n", per_pixel(time_ms([&]() {
+            terrain::internal::find_paths(height);
+        })));
+        std::printf("  find_single_path_map %.1f\n", per_pixel(time_ms([&]() {
+            water::internal::find_single_path_map(height, size / 2, size / 2, 3, random_stream(0));
+        })));
+        std::printf("  generate_ocean_distance_map %.1f\n", per_pixel(time_ms([&]() {
+            generate_ocean_distance_map(height);
+        })));
+        auto water = height.copy();
+        std::printf("  filter_non_zero_neighbors %.1f\n", per_pixel(time_ms([&]() {
+            water::internal::filter_non_zero_neighbors(water, height);
+        })));
+        std::printf("  shapes::generate %.1f\n", per_pixel(time_ms([&]() {
+            shapes::generate(height);
+        })));
+    }
+}
@@ -0,0 +1,44 @@
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "thread_pool.h"
+#include "generators/noise.h"
+
+// scaling of the shared pool from 1 to N threads (the arguments, by default 1, 2, 4, ... up to the
+// number of cores): a cpu-bound parallel_for and generate_tiles
+int main(int argc, char** argv) {
+    std::vector<int> defaults;
+    for (int threads = 1; threads < static_cast<int>(std::thread::hardware_concurrency()); threads *= 2) {
+        defaults.push_back(threads);
+    }
+    defaults.push_back(std::max(1u, std::thread::hardware_concurrency()));
+
+    double loop_base = 0.0;
+    double tiles_base = 0.0;
+    for (auto threads : sizes(argc, argv, defaults)) {
+        thread_pool::configure(threads);
+
+        std::vector<double> sums(256);
+        auto loop = time_ms([&]() {
+            thread_pool::shared().parallel_for(0, sums.size(), [&](size_t i) {
+                double sum = 0.0;
+                for (int k = 0; k < 200000; k++) {
+                    sum += std::sin(i + k * 1e-3);
+                }
+                sums[i] = sum;
+            });
+        }, 3);
+        auto tiles = time_ms([&]() {
+            mapgen::generators::noise::internal::generate_tiles(256, 256, 16);
+        });
+
+        if (loop_base == 0.0) {
+            loop_base = loop;
+            tiles_base = tiles;
+        }
+        std::printf("%d threads: parallel_for %.1f ms (x%.2f), generate_tiles %.1f ms (x%.2f)\n", threads, loop, loop_base / loop, tiles, tiles_base / tiles);
+    }
+}
@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+#include "baseline_voronoi.h"
+#include "bench.h"
+#include "random_generator.h"
+#include "voronoi.h"
+
+// the grid labeller against the half-plane engine it replaced, for the site counts of the pipeline,
+// pixels the baseline leaves unlabelled are skipped
+int main(int argc, char** argv) {
+    for (auto size : sizes(argc, argv, {512, 1024, 2048})) {
+        for (int sites : {1024, 10000}) {
+            voronoi_generator grid;
+            baseline_voronoi_generator baseline;
+            random_stream stream(size * 31 + sites);
+            int added = 0;
+            while (added < sites) {
+                float x = stream() % size;
+                float y = stream() % size;
+                if (!grid.contains(x, y)) {
+                    grid.add(x, y);
+                    baseline.add(x, y);
+                    added++;
+                }
+            }
+
+            std::optional<image<float>> old_labels;
+            std::optional<voronoi_diagram> diagram;
+            auto baseline_ms = time_ms([&]() {
+                old_labels = baseline.generate(size, size);
+            });
+            auto grid_ms = time_ms([&]() {
+                diagram = grid.generate(size, size);
+            });
+
+            // labels that differ are equally near (a tie the baseline broke the other way) or one of
+            // the engines picked a farther site
+            size_t ties = 0;
+            size_t baseline_farther = 0;
+            size_t grid_farther = 0;
+            auto distance = [&](const uint32_t label, const size_t x, const size_t y) {
+                const auto& r = diagram->regions[label - 1];
+                double dx = r.x - static_cast<double>(x);
+                double dy = r.y - static_cast<double>(y);
+                return dx * dx + dy * dy;
+            };
+            old_labels->for_each_pixel([&](float p, size_t x, size_t y) {
+                auto label = diagram->labels.at(x, y);
+                if (p == 0.0f || p == label) {
+                    return;
+                }
+                auto old_distance = distance(p, x, y);
+                auto new_distance = distance(label, x, y);
+                ties += old_distance == new_distance;
+                baseline_farther += old_distance > new_distance;
+                grid_farther += old_distance < new_distance;
+            });
+            std::printf("%d^2 %d sites: baseline %.1f ms, grid %.1f ms, differing pixels: %zu ties, %zu baseline farther, %zu grid farther\n", size, sites, baseline_ms, grid_ms, ties, baseline_farther, grid_farther);
+        }
+    }
+}
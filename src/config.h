@@ -16,6 +16,19 @@ namespace config {
         constexpr static const float erosion_factor = 0.9;
     };
     
+    struct chunks {
+        // every cell of tile_size x tile_size pixels of the world places tiles_per_cell tiles
+        // starting within the cell, the tiles are picked from a bank of num_tiles tiles per seed
+        constexpr static const int tile_size = 512;
+        constexpr static const int num_tiles = 64;
+        constexpr static const int tiles_per_cell = 32;
+        // banks of this many seeds are cached, a bank takes up to num_tiles tiles
+        constexpr static const int cached_banks = 4;
+        // the sum of the tiles covering a pixel is divided by this and clamped to [0, 1], sums above
+        // it are rare
+        constexpr static const float range = 3.5;
+    };
+
     struct water {
         constexpr static const int num_simulation = 100;
         constexpr static const int filterbox_size = 20;
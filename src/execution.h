@@ -0,0 +1,27 @@
+#pragma once
+
+#include <type_traits>
+
+namespace execution {
+
+struct sequenced_policy {};
+struct parallel_policy {};
+struct parallel_unsequenced_policy {};
+
+inline constexpr sequenced_policy seq;
+inline constexpr parallel_policy par;
+inline constexpr parallel_unsequenced_policy par_unseq;
+
+template<typename T>
+concept policy =
+    std::is_same_v<std::remove_cvref_t<T>, sequenced_policy> ||
+    std::is_same_v<std::remove_cvref_t<T>, parallel_policy> ||
+    std::is_same_v<std::remove_cvref_t<T>, parallel_unsequenced_policy>;
+
+template<typename T>
+concept parallel = policy<T> && !std::is_same_v<std::remove_cvref_t<T>, sequenced_policy>;
+
+template<typename T>
+concept unsequenced = std::is_same_v<std::remove_cvref_t<T>, parallel_unsequenced_policy>;
+
+}
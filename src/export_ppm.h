@@ -11,7 +11,7 @@
 #include "image.h"
 
 /**
-* Exports the sample to an Portable_Anymap(.pgm)-file
+* Exports the sample to an Portable_Anymap(.pgm)-file, uint16_t images are written with 16 bit per sample
 * --> https://de.wikipedia.org/wiki/Portable_Anymap
 * @param filename: the output-file
 * @return: true on success
@@ -26,6 +26,17 @@ bool export_ppm(const std::string& filename, const image<T>& img) {
         file << std::to_string(img.width());
         file << " ";
         file << std::to_string(img.height());
+        if constexpr (std::is_same_v<T, uint16_t>) {
+            // 16 bit samples are stored most significant byte first
+            file << " 65535 ";
+
+            img.for_each_pixel([&](const uint16_t& p) {
+                file << (uint8_t)(p >> 8) << (uint8_t)(p & 0xff);
+            });
+
+            return file.good();
+        }
+
         file << " 255 ";
 
         img.for_each_pixel([&](const float& p) {
@@ -42,6 +53,40 @@ bool export_ppm(const std::string& filename, const image<T>& img) {
     return false;
 }
 
+/**
+* Exports an image that is produced in bands of rows and never exists as a whole, the header is
+* written first, then for_each_band(write) has to call write(band) for every band from top to bottom
+* @param filename: the output-file
+* @return: true on success
+*/
+template <typename F>
+bool export_ppm(const std::string& filename, const size_t width, const size_t height, const F& for_each_band) {
+    std::ofstream file;
+    file.open(filename);
+
+    if (file.is_open()) {
+        file << "P5 ";
+        file << std::to_string(width);
+        file << " ";
+        file << std::to_string(height);
+        file << " 255 ";
+
+        std::vector<char> row(width);
+        for_each_band([&](const image<float>& band) {
+            for (size_t y = 0; y < band.height(); y++) {
+                for (size_t x = 0; x < width; x++) {
+                    row[x] = (uint8_t) (band.at(x, y) * 255);
+                }
+                file.write(row.data(), row.size());
+            }
+        });
+
+        return file.good();
+    }
+
+    return false;
+}
+
 template <typename T>
 std::optional<image<T>> import_ppm(const std::string& filename) {
     std::ifstream file;
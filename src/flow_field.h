@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "image.h"
+
+// the step to take from a pixel towards the end of its path
+enum class flow_direction : uint8_t {
+    north,
+    east,
+    south,
+    west
+};
+
+// result of a shortest path search over an image: the cost to reach an end pixel and the first
+// step of that path for every pixel, stored as a float score plane plus a 2 bit direction plane
+// and a 1 bit end plane
+// pixels that no search reached are undefined, their score is infinite
+class flow_field {
+public:
+    flow_field(const size_t width, const size_t height) :
+        m_scores(width, height, std::numeric_limits<float>::infinity(), 1, 0.0f),
+        m_directions((width + 3) / 4, height),
+        m_ends((width + 7) / 8, height) {}
+
+    size_t width() const {
+        return m_scores.width();
+    }
+    size_t height() const {
+        return m_scores.height();
+    }
+
+    // the halo of the scores is 0, so relaxing the neighbours of a border pixel never leaves the image
+    image<float>& scores() {
+        return m_scores;
+    }
+    const image<float>& scores() const {
+        return m_scores;
+    }
+    float score(const int x, const int y) const {
+        return m_scores.at(x, y);
+    }
+    bool is_defined(const int x, const int y) const {
+        return score(x, y) != std::numeric_limits<float>::infinity();
+    }
+    bool is_end(const int x, const int y) const {
+        return (m_ends.at(x / 8, y) >> (x % 8)) & 1;
+    }
+    flow_direction direction(const int x, const int y) const {
+        return static_cast<flow_direction>((m_directions.at(x / 4, y) >> (2 * (x % 4))) & 3);
+    }
+
+    void set_end(const int x, const int y) {
+        m_scores.at(x, y) = 0.0f;
+        m_ends.at(x / 8, y) |= 1 << (x % 8);
+    }
+    void set_direction(const int x, const int y, const flow_direction direction) {
+        auto& packed = m_directions.at(x / 4, y);
+        auto shift = 2 * (x % 4);
+        packed = (packed & ~(3 << shift)) | (static_cast<uint8_t>(direction) << shift);
+    }
+
+    static std::pair<int, int> step(const int x, const int y, const flow_direction direction) {
+        switch (direction) {
+            case flow_direction::north:
+                return {x, y - 1};
+            case flow_direction::east:
+                return {x + 1, y};
+            case flow_direction::south:
+                return {x, y + 1};
+            case flow_direction::west:
+                return {x - 1, y};
+        }
+        return {x, y};
+    }
+
+    // follows the directions from (x, y) and calls visit(x, y) for every pixel before the end
+    // pixel, returns the end pixel (or the first undefined one)
+    template<typename exec_T>
+    std::pair<int, int> trace(int x, int y, const exec_T& visit) const {
+        while (!is_end(x, y) && is_defined(x, y)) {
+            visit(x, y);
+            std::tie(x, y) = step(x, y, direction(x, y));
+        }
+
+        return {x, y};
+    }
+private:
+    image<float> m_scores;
+    image<uint8_t> m_directions;
+    image<uint8_t> m_ends;
+};
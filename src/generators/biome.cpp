@@ -1,5 +1,6 @@
 #include "biome.h"
 
+#include "image_expression.h"
 #include "temperature.h"
 #include "moisture.h"
 
@@ -7,47 +8,37 @@ namespace mapgen::generators::biome {
 using namespace internal;
 
 biome_maps generate(const image<float>& terrain, const image<float>& rivers) {
-    auto cells = mask_to_regions(terrain, 1024);
+    auto labels = mask_to_regions(terrain, 1024, random_seed::stream("biome.cells")).labels;
+    auto cells = labels.convert<float>();
 
     scale_range(cells);
     
     return {
         .cells = cells,
-        .temperature = generate_cell_map(cells, mapgen::generators::temperature::generate(terrain)),
-        .moisture = generate_cell_map(cells, mapgen::generators::moisture::generate(rivers, terrain)),
-        .altitude = generate_cell_map(cells, terrain)
+        .temperature = generate_cell_map(labels, mapgen::generators::temperature::generate(terrain)),
+        .moisture = generate_cell_map(labels, mapgen::generators::moisture::generate(rivers, terrain)),
+        .altitude = generate_cell_map(labels, terrain)
     };
 }
 
 namespace internal {
 
-image<float> generate_cell_map(const image<float>& cells, const image<float>& data) {
-    auto result = cells.copy_shape();
-
-    std::unordered_map<float, std::pair<float, int>> region_stats;
-    std::unordered_map<float, float> conversion;
-
-    cells.for_each_pixel([&](auto& p, auto x, auto y) {
-        if (p > 0) {
-            auto& [sum, count] = region_stats[p];
-            count++;
-            sum += data.at(x, y);
+image<float> generate_cell_map(const label_image& labels, const image<float>& data) {
+    auto pairs = expression::zip([](uint32_t label, float value) {
+        return std::pair(label, value);
+    }, labels, data);
+    auto region_stats = expression::reduce(execution::par, pairs, expression::by_label<uint32_t, expression::combined<expression::sum<float>, expression::count<float>>>());
+
+    // pixels outside of all regions stay 0
+    std::vector<float> averages(std::max<size_t>(1, region_stats.size()), 0.0f);
+    for (size_t i = 1; i < region_stats.size(); i++) {
+        auto [sum, count] = region_stats[i];
+        if (count > 0) {
+            averages[i] = sum / count;
         }
-    });
-
-    for (auto [key, value] : region_stats) {
-        auto [sum, count] = value;
-        auto avg = sum / count;
-        conversion[key] = avg;
     }
 
-    cells.for_each_pixel([&](auto& p, auto x, auto y) {
-        if (p > 0) {
-            result.at(x, y) = conversion[p];
-        }
-    });
-
-    return result;
+    return remap(execution::par, labels, averages);
 }
 
 }
@@ -2,6 +2,7 @@
 
 #include "image.h"
 #include "helper.h"
+#include "label_image.h"
 
 
 namespace mapgen::generators::biome {
@@ -17,7 +18,8 @@ biome_maps generate(const image<float>& weights, const image<float>& rivers);
 
 namespace internal {
 
-image<float> generate_cell_map(const image<float>& cells, const image<float>& data);
+// average of data over every region of labels
+image<float> generate_cell_map(const label_image& labels, const image<float>& data);
 
 }
 }
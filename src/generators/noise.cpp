@@ -1,7 +1,15 @@
 #include "noise.h"
 
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <optional>
+
 #include "config.h"
 #include "helper.h"
+#include "image_expression.h"
+#include "simd.h"
+#include "thread_pool.h"
 
 #include "random_generator.h"
 
@@ -77,9 +85,9 @@ void add_erosion(random_generator& rnd, image<float>& map) {
     map = copy;
 }
 
-image<float> generate_tile(const int width, const int height) {
+image<float> generate_tile(const int width, const int height, const random_stream& stream) {
     image<float> map(width, height);
-    random_generator rnd;
+    random_generator rnd(stream);
 
     auto dis = rnd.uniform<int>(config::terrain::min_base_noise, config::terrain::max_base_noise);
     auto dis_width = rnd.uniform<int>(0, width - 1);
@@ -98,15 +106,11 @@ image<float> generate_tile(const int width, const int height) {
     }
 
     scale_range(map);
-    for (int i = 0; i < config::terrain::num_pre_blur; i++) {
-        add_gaussian_blur(map);
-    }
+    add_gaussian_blur(map, config::terrain::num_pre_blur);
 
     add_erosion(rnd, map);
     
-    for (int i = 0; i < config::terrain::num_post_blur; i++) {
-        add_gaussian_blur(map);
-    }
+    add_gaussian_blur(map, config::terrain::num_post_blur);
     scale_range(map);
 
     fade_borders(map, config::terrain::max_hill_size);
@@ -114,111 +118,355 @@ image<float> generate_tile(const int width, const int height) {
     return map;
 }
 
-std::vector<image<float>> generate_tiles(const int width, const int height, const int n) {
-    std::vector<image<float>> tiles;
-    std::vector<std::thread> threads;
-    std::mutex mutex;
-
-    for (int i = 0; i < std::min(8, n); i++) {
-        std::thread t1([&]() {
-            std::unique_lock ul(mutex);
-            while (true) {
-                if (tiles.size() > n) {
-                    return;
-                }
-                ul.unlock();
-                image<float> tile = generate_tile(width, height);
-                ul.lock();
-                tiles.push_back(std::move(tile));
-            }
-        });
-
-        threads.push_back(std::move(t1));
-    }
-
-    for (auto& t : threads) {
-        if (t.joinable()) {
-            t.join();
-        }
-    }
+tile_set generate_tiles(const int width, const int height, const int n) {
+    std::vector<std::optional<image<float>>> generated(std::max(0, n));
+    tile_set result;
+    result.ranges.resize(generated.size());
 
-    return tiles;
-}
+    thread_pool::shared().parallel_for(0, generated.size(), [&](size_t index) {
+        generated[index] = generate_tile(width, height, random_seed::stream("noise.tiles", index));
+        result.ranges[index] = expression::reduce(execution::seq, *generated[index], expression::minmax<float>());
+    });
 
-void apply_threshold(image<float>& tile, float threshold) {
-    if (threshold == 0) {
-        threshold = 0.1;
+    for (auto& tile : generated) {
+        result.tiles.push_back(std::move(*tile));
     }
-    tile.for_each_pixel([&](float& m) {
-        if (m <= threshold) {
-            m = threshold;
-        }
-    });
 
-    scale_range(tile);
+    return result;
 }
 
-image<float> generate_segment(const std::vector<image<float>>& tiles, random_generator& rnd, const int width, const int height) {
+image<float> generate_segment(const tile_set& tiles, random_generator& rnd, const int width, const int height) {
     image<float> map(width * 2, height * 2);
     auto dis_width = rnd.uniform<int>(0, width);
     auto dis_height = rnd.uniform<int>(0, height);
     auto dis = rnd.uniform<float>(0, 1.0);
 
     for (int i = 0; i < 128; i++) {
-        auto tile = rnd.roll_in(tiles);
-        apply_threshold(tile, rnd.uniform<float>(0.1, 0.7).next());
+        auto index = rnd.uniform<size_t>(0, tiles.tiles.size() - 1).next();
+        auto threshold = rnd.uniform<float>(0.1, 0.7).next();
+        const auto& tile = tiles.tiles[index];
+
+        // range of the tile after clamping it to threshold
+        auto [min, max] = tiles.ranges[index];
+        min = std::max(min, threshold);
+        max = std::max(0.0f, std::max(max, threshold));
+        float factor = range_factor(min, max);
 
         auto b = dis.next();
         auto x = dis_width.next();
         auto y = dis_height.next();
 
-        if (auto subregion = map.subregion(x, y, width, height)) {
-            subregion->for_each_pixel([&](auto& c, auto x, auto y) {
-                c += std::max(0.0f, b * tile.at(x, y));
-            });
+        if (map.contains(x, y, width, height)) {
+            for (int row = 0; row < height; row++) {
+                simd::threshold_scale_add(map.row(y + row).data() + x, tile.row(row).data(), width, threshold, min, factor, b);
+            }
         }
     }
     scale_range(map);
     return map;
 }
 
+tile_bank::tile_bank(const uint64_t seed, const int width, const int height, const size_t n) : m_seed(seed), m_stream(random_stream(seed).derive("noise.tiles")), m_width(width), m_height(height) {
+    for (size_t i = 0; i < n; i++) {
+        m_entries.push_back(std::make_unique<entry>());
+    }
+}
+
+std::shared_ptr<tile_bank> tile_bank::of(const uint64_t seed) {
+    static std::mutex mutex;
+    // most recently used first
+    static std::list<std::shared_ptr<tile_bank>> banks;
+
+    std::unique_lock ul(mutex);
+    auto it = std::find_if(banks.begin(), banks.end(), [&](const auto& bank) {
+        return bank->m_seed == seed;
+    });
+    if (it != banks.end()) {
+        banks.splice(banks.begin(), banks, it);
+        return banks.front();
+    }
+
+    banks.push_front(std::make_shared<tile_bank>(seed, config::chunks::tile_size, config::chunks::tile_size, config::chunks::num_tiles));
+    if (banks.size() > static_cast<size_t>(config::chunks::cached_banks)) {
+        banks.pop_back();
+    }
+
+    return banks.front();
+}
+
+const image<float>& tile_bank::tile(const size_t i) {
+    return *get(i).tile;
+}
+
+std::pair<float, float> tile_bank::range(const size_t i) {
+    return get(i).range;
+}
+
+tile_bank::entry& tile_bank::get(const size_t i) {
+    auto& e = *m_entries.at(i);
+    {
+        std::unique_lock ul(e.mutex);
+        if (e.tile) {
+            return e;
+        }
+    }
+
+    // the generation runs jobs of the pool, holding the lock meanwhile could block a job that
+    // asks for the same tile on this thread
+    auto tile = generate_tile(m_width, m_height, m_stream.derive(i));
+    auto range = expression::reduce(execution::seq, tile, expression::minmax<float>());
+
+    std::unique_lock ul(e.mutex);
+    if (!e.tile) {
+        e.tile = std::move(tile);
+        e.range = range;
+    }
+
+    return e;
+}
+
 }
 
 namespace mapgen::generators::noise {
 
+source::source(const int width, const int height, const int scale) : m_width(width), m_height(height), m_scale(scale), m_tiles(internal::generate_tiles(width, height, 512)) {
+    // the extent of the old canvas, pixels of it that no segment reaches are 0
+    int canvas_width = width * 2 * scale;
+    int canvas_height = height * 2 * scale;
+    int covered_width = 0;
+    int covered_height = 0;
+    for (int i = 0; i < scale; i++) {
+        if (is_placed(i, 0)) {
+            covered_width = std::max(covered_width, segment_left(i) + width * 2);
+        }
+        if (is_placed(0, i)) {
+            covered_height = std::max(covered_height, segment_top(i) + height * 2);
+        }
+    }
+
+    expression::minmax<float> range;
+    auto total = range.identity();
+    for_each_raw_band(covered_width, covered_height, height * 2, [&](int y, image<float>& band) {
+        range.merge(total, expression::reduce(execution::par, band, range));
+    });
+    auto [min, max] = total;
+    if (covered_width < canvas_width || covered_height < canvas_height) {
+        min = std::min(min, 0.0f);
+    }
+    max = std::max(0.0f, max);
+
+    m_min = min;
+    m_factor = range_factor(min, max);
+}
+
+int source::width() const {
+    return std::min((m_scale + 1) * m_width, m_width * 2 * m_scale);
+}
+
+int source::height() const {
+    return std::min((m_scale + 1) * m_height, m_height * 2 * m_scale);
+}
+
+image<float> source::render(const int x, const int y, const int width, const int height) const {
+    image<float> result(width, height);
+
+    for (int grid_y = 0; grid_y < m_scale; grid_y++) {
+        auto top = segment_top(grid_y);
+        if (top >= y + height || top + m_height * 2 <= y) {
+            continue;
+        }
+        add_row(result, x, y, grid_y, generate_row(grid_y, x, x + width));
+    }
+    result.shift_and_scale(execution::par, -m_min, m_factor);
+
+    return result;
+}
+
+void source::for_each_band(const int rows, const std::function<void(int, const image<float>&)>& call) const {
+    for_each_raw_band(width(), height(), rows, [&](int y, image<float>& band) {
+        band.shift_and_scale(execution::par, -m_min, m_factor);
+        call(y, band);
+    });
+}
+
+int source::segment_left(const int x) const {
+    // neighbouring segments overlap by 512 pixels
+    return x * (m_width * 2 - 512);
+}
+
+int source::segment_top(const int y) const {
+    return y * (m_height * 2 - 512);
+}
+
+bool source::is_placed(const int x, const int y) const {
+    auto left = segment_left(x);
+    auto top = segment_top(y);
+    return 0 <= left && left + m_width * 2 <= m_width * 2 * m_scale && 0 <= top && top + m_height * 2 <= m_height * 2 * m_scale;
+}
+
+source::segment_row source::generate_row(const int y, const int left, const int right) const {
+    segment_row row(m_scale);
+
+    // segment i draws from its own stream, so the segments of a row are generated concurrently
+    thread_pool::shared().parallel_for(0, m_scale, [&](size_t x) {
+        auto segment_x = segment_left(x);
+        if (is_placed(x, y) && segment_x < right && segment_x + m_width * 2 > left) {
+            random_generator rnd(random_seed::stream("noise.segments", y * m_scale + x));
+            row[x] = internal::generate_segment(m_tiles, rnd, m_width, m_height);
+        }
+    });
+
+    return row;
+}
+
+void source::add_row(image<float>& target, const int x, const int y, const int grid_y, const segment_row& row) const {
+    auto top = segment_top(grid_y);
+    auto begin = std::max(y, top);
+    auto end = std::min<int>(y + target.height(), top + m_height * 2);
+    if (begin >= end) {
+        return;
+    }
+
+    // every band of target rows adds the segments in the order of x
+    thread_pool::shared().for_each_band(end - begin, [&](auto band, auto band_begin, auto band_end) {
+        for (int grid_x = 0; grid_x < m_scale; grid_x++) {
+            if (!row[grid_x]) {
+                continue;
+            }
+            auto left = std::max(x, segment_left(grid_x));
+            auto right = std::min<int>(x + target.width(), segment_left(grid_x) + m_width * 2);
+            if (left >= right) {
+                continue;
+            }
+            for (auto r = begin + band_begin; r < begin + band_end; r++) {
+                simd::add(target.row(r - y).data() + (left - x), row[grid_x]->row(r - top).data() + (left - segment_left(grid_x)), right - left);
+            }
+        }
+    });
+}
+
+void source::for_each_raw_band(const int width, const int height, const int rows, const std::function<void(int, image<float>&)>& call) const {
+    // grid rows overlapping the current band, oldest first
+    std::deque<std::pair<int, segment_row>> window;
+    int next_row = 0;
+
+    for (int y = 0; y < height; y += rows) {
+        auto band_height = std::min(rows, height - y);
+
+        while (!window.empty() && segment_top(window.front().first) + m_height * 2 <= y) {
+            window.pop_front();
+        }
+        while (next_row < m_scale && segment_top(next_row) < y + band_height) {
+            if (segment_top(next_row) + m_height * 2 > y) {
+                window.emplace_back(next_row, generate_row(next_row, 0, width));
+            }
+            next_row++;
+        }
+
+        image<float> band(width, band_height);
+        for (const auto& [grid_y, row] : window) {
+            add_row(band, 0, y, grid_y, row);
+        }
+        call(y, band);
+    }
+}
+
 image<float> generate(const int width, const int height, const int scale, const float fade_factor, const float threshold, const float noise_factor) {
-    random_generator rnd;
+    source noise(width, height, scale);
+    return noise.render(0, 0, noise.width(), noise.height());
+}
 
-    image<float> map(width * 2 * scale, height * 2 * scale);
+namespace {
+
+// a tile placed by a cell of the world, clamped and rescaled like in generate_segment()
+struct placement {
+    int64_t x;
+    int64_t y;
+    size_t index;
+    float threshold;
+    float min;
+    float factor;
+    float b;
+};
+
+int64_t floor_div(const int64_t a, const int64_t b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
 
-    std::vector<image<float>> segments;
-    std::vector<image<float>> tiles = internal::generate_tiles(width, height, 512);
+}
 
-    for (int i = 0; i < scale * scale; i++) {
-        segments.push_back(internal::generate_segment(tiles, rnd, width, height));
+image<float> chunk(const uint64_t seed, const int64_t cx, const int64_t cy, const int size) {
+    static_assert(config::chunks::tile_size > 0 && config::chunks::num_tiles > 0 && config::chunks::tiles_per_cell >= 0, "chunks need a non empty bank and cell");
+    if (size <= 0) {
+        return image<float>(0, 0);
     }
 
-    int i = 0;
-    for (int y = 0; y < scale; y++) {
-        for (int x = 0; x < scale; x++) {
-            image<float>& tile = segments[i];
-            i++;
-            if (auto region = map.subregion(
-                x * tile.width() - 512 * x,
-                y * tile.height() - 512 * y,
-                tile.width(),
-                tile.height()
-            )) {
-                (*region).add(tile);
+    auto bank = internal::tile_bank::of(seed);
+    auto stream = random_stream(seed).derive("noise.chunks");
+    const int64_t cell = config::chunks::tile_size;
+    int64_t x0 = cx * size;
+    int64_t y0 = cy * size;
+
+    // a tile starts within its cell, so it reaches at most into the next cell
+    std::vector<placement> placements;
+    for (auto cell_y = floor_div(y0, cell) - 1; cell_y <= floor_div(y0 + size - 1, cell); cell_y++) {
+        for (auto cell_x = floor_div(x0, cell) - 1; cell_x <= floor_div(x0 + size - 1, cell); cell_x++) {
+            random_generator rnd(stream.derive(cell_x).derive(cell_y));
+            for (int i = 0; i < config::chunks::tiles_per_cell; i++) {
+                placement p;
+                p.index = rnd.uniform<size_t>(0, bank->size() - 1).next();
+                p.threshold = rnd.uniform<float>(0.1, 0.7).next();
+                p.b = rnd.uniform<float>(0, 1.0).next();
+                p.x = cell_x * cell + rnd.uniform<int>(0, cell - 1).next();
+                p.y = cell_y * cell + rnd.uniform<int>(0, cell - 1).next();
+                if (p.x < x0 + size && p.x + cell > x0 && p.y < y0 + size && p.y + cell > y0) {
+                    placements.push_back(p);
+                }
             }
         }
     }
-    scale_range(map);
 
-    if (auto result = map.subregion(0, 0, (scale + 1) * width, (scale + 1) * height)) {
-        return *result;
+    // the missing tiles of the bank are generated concurrently, each of them once
+    std::vector<size_t> indices;
+    for (const auto& p : placements) {
+        indices.push_back(p.index);
     }
-    return map;
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    thread_pool::shared().parallel_for(0, indices.size(), [&](size_t i) {
+        bank->tile(indices[i]);
+    });
+
+    for (auto& p : placements) {
+        auto [min, max] = bank->range(p.index);
+        min = std::max(min, p.threshold);
+        max = std::max(0.0f, std::max(max, p.threshold));
+        p.min = min;
+        // a tile below its threshold everywhere adds nothing
+        p.factor = range_factor(min, max);
+    }
+
+    image<float> result(size, size);
+
+    // every row adds the tiles covering it in the order of their cells and indices, which does not
+    // depend on the chunk
+    result.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+        for (const auto& p : placements) {
+            auto& tile = bank->tile(p.index);
+            auto left = std::max(x0, p.x);
+            auto right = std::min(x0 + size, p.x + cell);
+            for (auto y = std::max<int64_t>(y0 + begin, p.y); y < std::min<int64_t>(y0 + end, p.y + cell); y++) {
+                simd::threshold_scale_add(result.row(y - y0).data() + (left - x0), tile.row(y - p.y).data() + (left - p.x), right - left, p.threshold, p.min, p.factor, p.b);
+            }
+        }
+    });
+
+    auto factor = 1.0f / config::chunks::range;
+    result.for_each_pixel(execution::par, [&](float& p) {
+        p = std::min(1.0f, p * factor);
+    });
+
+    return result;
 }
 
 }
@@ -2,26 +2,118 @@
 
 #include <vector>
 #include <random>
-#include <thread>
+#include <functional>
+#include <optional>
+#include <memory>
 #include <mutex>
+#include <cstdint>
 
 #include "image.h"
 #include "random_generator.h"
 
 namespace mapgen::generators::noise {
 
+namespace internal {
+
+// the tiles and the range of values of every tile
+struct tile_set {
+    std::vector<image<float>> tiles;
+    std::vector<std::pair<float, float>> ranges;
+};
+
+}
+
+// the base noise without a canvas: a grid of scale x scale segments that overlap by 512 pixels,
+// segment i only depends on the seed and i, so any rectangle is rendered on demand from the
+// segments overlapping it, every pixel adds its segments in the order of their index
+// the constructor streams over all segments once to find the range of the canvas, so rendered
+// pixels are normalized to [0, 1] the same way wherever they are requested
+class source {
+public:
+    source(const int width, const int height, const int scale);
+
+    int width() const;
+    int height() const;
+
+    image<float> render(const int x, const int y, const int width, const int height) const;
+    // renders the whole source in bands of rows from top to bottom and calls call(y, band), the
+    // segments of a grid row are generated once and dropped after the last band they overlap
+    void for_each_band(const int rows, const std::function<void(int, const image<float>&)>& call) const;
+private:
+    using segment_row = std::vector<std::optional<image<float>>>;
+
+    int segment_left(const int x) const;
+    int segment_top(const int y) const;
+    bool is_placed(const int x, const int y) const;
+    segment_row generate_row(const int y, const int left, const int right) const;
+    void add_row(image<float>& target, const int x, const int y, const int grid_y, const segment_row& row) const;
+    void for_each_raw_band(const int width, const int height, const int rows, const std::function<void(int, image<float>&)>& call) const;
+
+    int m_width;
+    int m_height;
+    int m_scale;
+    internal::tile_set m_tiles;
+    float m_min;
+    float m_factor;
+};
+
 image<float> generate(const int width, const int height, const int scale, const float fade_factor, const float threshold, const float noise_factor);
 
+// base noise of an endless world, chunk (cx, cy) covers the pixels [cx * size, (cx + 1) * size) x
+// [cy * size, (cy + 1) * size): the tiles placed within a cell of the world only depend on the seed
+// and the cell, every pixel adds the tiles covering it in the same order whichever chunk it is
+// rendered for, so neighbouring chunks continue each other seamlessly and chunks can be generated
+// in any order and concurrently
+// unlike generate() the values are not normalized to the range of a canvas but by a fixed factor,
+// size does not have to be a multiple of the cell size, a size below 1 gives an empty image
+image<float> chunk(const uint64_t seed, const int64_t cx, const int64_t cy, const int size);
+
 namespace internal {
 
 void generate_hill(random_generator& rnd, image<float>& map, const int x, const int y, const int size, const int min, const int max);
 std::pair<int, int> min_random_neighbor(random_generator& rnd, const image<float>& map, const int x, const int y);
 void add_erosion(random_generator& rnd, image<float>& map);
-image<float> generate_tile(const int width, const int height);
-std::vector<image<float>> generate_tiles(const int width, const int height, const int n);
+image<float> generate_tile(const int width, const int height, const random_stream& stream);
+// tile i is generated from its own stream, so the tiles do not depend on the number of threads
+tile_set generate_tiles(const int width, const int height, const int n);
+
+// adds 128 tiles at random positions, every tile is clamped to a random threshold and the clamped
+// range is rescaled to [0, 1] on the fly from the range of the tile, the tiles are only read
+image<float> generate_segment(const tile_set& tiles, random_generator& rnd, const int width, const int height);
+
+// the tiles of a seed for chunk(), tile i is generated on its first use from the same stream as
+// the tile i of generate_tiles() for that seed
+class tile_bank {
+public:
+    tile_bank(const uint64_t seed, const int width, const int height, const size_t n);
+    tile_bank(const tile_bank&) = delete;
+    void operator=(const tile_bank&) = delete;
+
+    // the bank of a seed, the banks of the config::chunks::cached_banks most recently asked for
+    // seeds are kept, an evicted bank lives on while a caller holds it
+    static std::shared_ptr<tile_bank> of(const uint64_t seed);
+
+    size_t size() const {
+        return m_entries.size();
+    }
+    // generates tile i if it is missing, threads asking for a missing tile at the same time all
+    // generate it and the first one keeps it, they never wait for each other
+    const image<float>& tile(const size_t i);
+    std::pair<float, float> range(const size_t i);
+private:
+    struct entry {
+        std::mutex mutex;
+        std::optional<image<float>> tile;
+        std::pair<float, float> range;
+    };
+    entry& get(const size_t i);
 
-void apply_threshold(image<float>& tile, float threshold);
-image<float> generate_segment(const std::vector<image<float>>& tiles, random_generator& rnd, const int width, const int height);
+    uint64_t m_seed;
+    random_stream m_stream;
+    int m_width;
+    int m_height;
+    std::vector<std::unique_ptr<entry>> m_entries;
+};
 
 }
 
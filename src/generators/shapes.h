@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "image.h"
+#include "label_image.h"
 
 namespace mapgen::generators::shapes {
 
@@ -10,9 +11,9 @@ std::vector<std::pair<image<float>, image<float>>> generate(const image<float>&
 
 namespace internal {
 
-void label(auto& img);
-std::vector<std::pair<image<float>, image<float>>> extract(const auto& img, const auto& src);
-void flood_fill(auto& img, const int start_x, const int start_y, const float new_color, std::vector<std::vector<bool>>& visited);
+void label(label_image& img);
+std::vector<std::pair<image<float>, image<float>>> extract(const label_image& img, const image<float>& src);
+void flood_fill(label_image& img, const int start_x, const int start_y, const uint32_t new_color, std::vector<std::vector<bool>>& visited);
 
 }
 }
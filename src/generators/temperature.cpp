@@ -5,29 +5,24 @@ namespace mapgen::generators::temperature {
 image<float> generate(const image<float>& map) {
     auto result = map.copy_shape();
 
-    result.for_each_pixel([&](auto& p, auto x, auto y) {
+    result.for_each_pixel(execution::par, [&](auto& p, auto x, auto y) {
         auto r = static_cast<float>(y) / map.height();
         p = 1.0 / (1.0 + std::exp(-0.5 * (r * 12 - 6)));
     });
 
-    auto regions = mask_to_regions(map, 1024);
-    std::unordered_map<float, float> conversion;
+    auto [regions, table] = mask_to_regions(map, 1024, random_seed::stream("temperature.regions"));
 
-    regions.for_each_pixel([&](auto& p) {
-        conversion[p] = 0.0f;
-    });
-
-    for (auto& [key, value] : conversion) {
-        value = random_float(0.99f, 1.01f);
+    // the factor of a region only depends on its id
+    auto variation = random_seed::stream("temperature.variation");
+    std::vector<float> conversion(table.size() + 1, 1.0f);
+    for (const auto& region : table) {
+        conversion[region.id] = uniform_float(variation.at(region.id), 0.99f, 1.01f);
     }
 
-    conversion[0] = 1.0f;
-    regions.for_each_pixel([&](auto& p) {
-        p = conversion[p];
-    });
+    const auto factors = remap(execution::par, regions, conversion);
 
-    result.for_each_pixel([&](auto& p, auto x, auto y) {
-        p = p * regions.at(x, y) * (1.0f - map.at(x, y));
+    result.for_each_pixel(execution::par_unseq, [&](auto& p, auto x, auto y) {
+        p = p * factors.at(x, y) * (1.0f - map.at(x, y));
     });
 
     scale_range(result);
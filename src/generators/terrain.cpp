@@ -1,34 +1,21 @@
 #include "terrain.h"
 
 #include "circle_stack.h"
+#include "image_expression.h"
 
 namespace mapgen::generators::terrain {
 
-std::pair<image<float>, image<float>> generate(const std::vector<std::pair<image<float>, image<float>>>& shapes, const image<float>& noise, const int width, const int height) {
+std::pair<image<uint8_t>, image<float>> generate(const std::vector<std::pair<image<float>, image<float>>>& shapes, const image<float>& noise, const int width, const int height) {
     assert(!shapes.empty());
     
-    auto [mask, weights] = *shapes.rbegin();
+    auto [shape, weights] = *shapes.rbegin();
 
-    mask = resize_and_center(mask, width, height);
-    weights = resize_and_center(weights, width, height);
-    
-    mask.for_each_pixel([&](auto& p) {
-        if (p < 0.000001f) {
-            p = 0.0f;
-        }
-    });
-    weights.for_each_pixel([&](auto& p) {
-        if (p < 0.000001f) {
-            p = 0.0f;
-        }
+    auto mask = resize_and_center(shape, width, height).convert<uint8_t>([](float p) {
+        return p < 0.000001f ? 0 : 1;
     });
+    weights = resize_and_center(weights, width, height);
 
     auto terrain = internal::create_terrain(weights, noise);
-    terrain.for_each_pixel([&](auto& p) {
-        if (p < 0.000001f) {
-            p = 0.0f;
-        }
-    });
 
     return {mask, terrain};
 }
@@ -51,15 +38,13 @@ void apply_circular_shift(image<float>& target, const image<float>& map, const i
     }
 }
 
-image<std::pair<direction, float>> find_paths(const image<float>& src) {
-    auto map = src.copy();
-    image<std::pair<direction, float>> path_map(map.width(), map.height());
+flow_field find_paths(const image<float>& src) {
+    // the halo of map is never lower than its neighbors, so border pixels need no bounds checks
+    image<float> map(src.width(), src.height(), 0.0f, 1, std::numeric_limits<float>::infinity());
+    flow_field field(src.width(), src.height());
+    src.copy_to(map);
 
-    path_map.for_each_pixel([](auto& m) {
-        m = {direction::undefined, std::numeric_limits<float>::infinity()};
-    });
-
-    auto noise = random_generator().uniform<int>(0, 10) ;
+    auto noise = random_generator(random_seed::stream("terrain.paths")).uniform<int>(0, 10);
 
     map.for_each_pixel([&](float& p) {
         if (p < 0.01) {
@@ -78,52 +63,33 @@ image<std::pair<direction, float>> find_paths(const image<float>& src) {
     for (int y = 0; y < map.height(); y++)  {
         for (int x = 0; x < map.width(); x++)  {
             if (map.at(x, y) == 0.0f) {
-                path_map.at(x, y) = {direction::end, 0};
+                field.set_end(x, y);
                 updated_positions[0].push_back({x, y});
             }
         }
     }
 
+    const std::pair<int, int> offsets[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    const flow_direction directions[] = {flow_direction::east, flow_direction::west, flow_direction::south, flow_direction::north};
+    auto& scores = field.scores();
+
     int current_mode = 0;
     int next_mode = 1;
     while (!updated_positions[current_mode].empty()) {
         for (auto [x, y] : updated_positions[current_mode]) {
-            auto& [d, current_score] = path_map.at(x, y);
-            auto& current_height = map.at(x, y);
-            if (auto neighbor_height = map.get(x - 1, y)) {
-                auto& [neighbor_direction, neighbor_score] = path_map.at(x - 1, y);
-                auto delta = std::max(0.0f, **neighbor_height - current_height);
-                if (current_score + delta < neighbor_score) {
-                    neighbor_direction = direction::east;
-                    neighbor_score = current_score + delta;
-                    updated_positions[next_mode].push_back({x - 1, y});
-                }
-            }
-            if (auto neighbor_height = map.get(x + 1, y)) {
-                auto& [neighbor_direction, neighbor_score] = path_map.at(x + 1, y);
-                auto delta = std::max(0.0f, **neighbor_height - current_height);
-                if (current_score + delta < neighbor_score) {
-                    neighbor_direction = direction::west;
-                    neighbor_score = current_score + delta;
-                    updated_positions[next_mode].push_back({x + 1, y});
-                }
-            }
-            if (auto neighbor_height = map.get(x, y - 1)) {
-                auto& [neighbor_direction, neighbor_score] = path_map.at(x, y - 1);
-                auto delta = std::max(0.0f, **neighbor_height - current_height);
-                if (current_score + delta < neighbor_score) {
-                    neighbor_direction = direction::south;
-                    neighbor_score = current_score + delta;
-                    updated_positions[next_mode].push_back({x, y - 1});
-                }
-            }
-            if (auto neighbor_height = map.get(x, y + 1)) {
-                auto& [neighbor_direction, neighbor_score] = path_map.at(x, y + 1);
-                auto delta = std::max(0.0f, **neighbor_height - current_height);
+            auto* height = map.pointer(x, y);
+            auto* score = scores.pointer(x, y);
+            auto current_score = *score;
+            auto current_height = *height;
+
+            for (int i = 0; i < 4; i++) {
+                auto [dx, dy] = offsets[i];
+                auto& neighbor_score = score[scores.neighbor_offset(dx, dy)];
+                auto delta = std::max(0.0f, height[map.neighbor_offset(dx, dy)] - current_height);
                 if (current_score + delta < neighbor_score) {
-                    neighbor_direction = direction::north;
                     neighbor_score = current_score + delta;
-                    updated_positions[next_mode].push_back({x, y + 1});
+                    field.set_direction(x + dx, y + dy, directions[i]);
+                    updated_positions[next_mode].push_back({x + dx, y + dy});
                 }
             }
         }
@@ -133,11 +99,11 @@ image<std::pair<direction, float>> find_paths(const image<float>& src) {
         next_mode = (next_mode + 1) % 2;
     }
 
-    return path_map;
+    return field;
 }
 
-void traverse_paths(image<float>& map, const image<std::pair<direction, float>>& path_map) {
-    random_generator rnd;
+void traverse_paths(image<float>& map, const flow_field& field) {
+    random_generator rnd(random_seed::stream("terrain.traverse"));
 
     auto dis_width = rnd.uniform<int>(0, map.width() - 1);
     auto dis_height = rnd.uniform<int>(0, map.height() - 1);
@@ -158,24 +124,9 @@ void traverse_paths(image<float>& map, const image<std::pair<direction, float>>&
             y = dis_height.next();
         } while (map.at(x, y) == 0.0 && map.at(x, y) > 0.75);
 
-        while (path_map.at(x, y).first != direction::end) {
+        field.trace(x, y, [&](const int x, const int y) {
             water_level.at(x, y)++;
-
-            auto [direction, score] = path_map.at(x, y);
-
-            if (direction == direction::north) {
-                y--;
-            }
-            if (direction == direction::east) {
-                x++;
-            }
-            if (direction == direction::south) {
-                y++;
-            }
-            if (direction == direction::west) {
-                x--;
-            }
-        }
+        });
     }
 
     circle_stack circles;
@@ -190,35 +141,27 @@ void traverse_paths(image<float>& map, const image<std::pair<direction, float>>&
 }
 
 image<float> create_terrain(const image<float>& weights, const image<float>& noise) {
-    auto map = weights.copy();
-    auto result = noise.copy();
+    image<float> map(weights.width(), weights.height(), image_init::uninitialized);
 
-    map.for_each_pixel([&](auto& p, auto x, auto y) {
+    auto [min, max] = map.assign(execution::par, expression::map(weights, [](float p) {
         p = p * p;
         p = p * p;
-        p = 1.0 / (1.0 + std::exp(-0.5 * (p * 12 - 6)));
-    });
+        return static_cast<float>(1.0 / (1.0 + std::exp(-0.5 * (p * 12 - 6))));
+    }), expression::minmax<float>());
+    map.shift_and_scale(execution::par, -min, range_factor(min, std::max(0.0f, max)));
 
-    scale_range(map);
-    for (int i = 0; i < 25; i++) {
-        add_gaussian_blur(map);
-    }
+    add_gaussian_blur(map, 25);
     scale_range(map);
 
-    auto path_map = find_paths(map);
-    traverse_paths(map, path_map);
+    auto field = find_paths(map);
+    traverse_paths(map, field);
     scale_range(map);
 
-    auto iv = map.copy();
-    iv.for_each_pixel([&](auto& p) {
-        if (p < 0.01) {
-            p = 1.0f;
-        } else {
-            p = 0.0f;
-        }
+    auto iv = map.convert<uint8_t>([](float p) {
+        return p < 0.01 ? 1 : 0;
     });
 
-    auto distance = generate_ocean_distance_map(iv);
+    const auto distance = generate_ocean_distance_map(iv);
     image<float> coast_map(distance.width(), distance.height());
     coast_map.for_each_pixel([&](auto& p, auto x, auto y) {
         auto d = distance.at(x, y);
@@ -230,38 +173,52 @@ image<float> create_terrain(const image<float>& weights, const image<float>& noi
         }
     });
 
-    map = map.rescale(result.width(), result.height());
-    coast_map = coast_map.rescale(result.width(), result.height());
-    scale_range(map);
-    scale_range(coast_map);
+    map = map.rescale(noise.width(), noise.height());
+    coast_map = coast_map.rescale(noise.width(), noise.height());
 
-    scale_range(result);
+    // scale_range of the inputs and of every intermediate result is folded into the sweeps
+    // below, each of them yields the range that the next one scales by
+    auto scale_of = [](const std::pair<float, float>& range) {
+        auto [min, max] = range;
+        return std::pair<float, float>(min, range_factor(min, std::max(0.0f, max)));
+    };
+    auto [map_min, map_factor] = scale_of(expression::reduce(execution::par, map, expression::minmax<float>()));
+    auto [coast_min, coast_factor] = scale_of(expression::reduce(execution::par, coast_map, expression::minmax<float>()));
+    auto [noise_min, noise_factor] = scale_of(expression::reduce(execution::par, noise, expression::minmax<float>()));
 
-    result.for_each_pixel([&](auto& p, auto x, auto y) {
+    image<float> result(noise.width(), noise.height(), image_init::uninitialized);
+
+    auto [result_min, result_factor] = scale_of(result.assign(execution::par, expression::zip([=](float p, float s) {
+        p = (p - noise_min) * noise_factor;
+        s = (s - map_min) * map_factor;
         if (p < 0.01) {
             p = 0.0f;
         }
-        auto s = map.at(x, y);
 
         if (s > 0 && p > 0) {
-            p = (s + s * p) / 2;
-        } else {
-            p = 0;
+            return (s + s * p) / 2;
         }
-    });
-    scale_range(result);
+        return 0.0f;
+    }, noise, map), expression::minmax<float>()));
 
-    result.for_each_pixel([&](auto& p, auto x, auto y) {
-        auto c = coast_map.at(x, y);
+    auto [final_min, final_factor] = scale_of(result.assign(execution::par, expression::zip([=](float p, float c, float n) {
+        p = (p - result_min) * result_factor;
+        c = (c - coast_min) * coast_factor;
         if (0 < c && c < 1.0f) {
-            if (noise.at(x, y) > c) {
+            if (n > c) {
                 p = std::max(p, 0.01f);
             }
         }
-    });
-
+        return p;
+    }, result, coast_map, noise), expression::minmax<float>()));
 
-    scale_range(result);
+    result.assign(execution::par, expression::map(result, [=](float p) {
+        p = (p - final_min) * final_factor;
+        if (p < 0.000001f) {
+            p = 0.0f;
+        }
+        return p;
+    }));
 
     return result;
 }
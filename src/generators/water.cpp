@@ -1,26 +1,30 @@
 #include "water.h"
 
+#include <cassert>
+
 #include "helper.h"
 #include "circle_stack.h"
+#include "image_expression.h"
 
 namespace mapgen::generators::water {
 
 using namespace mapgen::generators::water::internal;
 
-std::pair<image<float>, image<float>> generate(const image<float>& mask, const image<float>& terrain, const std::vector<std::pair<image<float>, image<float>>>& shapes) {
+std::pair<image<float>, image<float>> generate(const image<uint8_t>& mask, const image<float>& terrain, const std::vector<std::pair<image<float>, image<float>>>& shapes) {
     auto scaled_terrain = terrain.rescale(mask.width(), mask.height());
 
-    auto river_regions = mask_to_border_regions(mask, 8);
-    auto river_distribution = generate_river_distribution(mask);
+    // only 8 labels and a probability per pixel, the narrow types quarter and halve these layers
+    auto river_regions = mask_to_border_regions(mask, 8, random_seed::stream("water.regions")).labels.convert<uint8_t>();
+    auto river_distribution = generate_river_distribution(mask).convert<half>();
 
-    auto water = river_regions.copy_shape();
+    image<float> water(river_regions.width(), river_regions.height());
 
+    auto rivers_per_region = compute_rivers_per_region(river_regions, 8, 1000);
     for (int i = 0; i < 8; i++) {
-        add_river_to_region(river_regions, i + 1.0f, 1000, scaled_terrain, water, river_distribution);
+        add_river_to_region(river_regions, i + 1, rivers_per_region[i + 1], scaled_terrain, water, river_distribution);
     }
 
     filter_non_zero_neighbors(water, scaled_terrain);
-    scale_range(river_regions);
     scale_range(water);
 
     auto [scaled_water, end_points] = upscale_river_map(water, scaled_terrain, terrain.width(), terrain.height());
@@ -33,9 +37,9 @@ std::pair<image<float>, image<float>> generate(const image<float>& mask, const i
 
 namespace internal {
 
-image<float> add_noise_to_img(const image<float>& src, int factor) {
+image<float> add_noise_to_img(const image<float>& src, int factor, const random_stream& stream) {
     auto map = src.copy();
-    auto dis_noice = random_generator().uniform<int>(0, 10);
+    auto dis_noice = random_generator(stream).uniform<int>(0, 10);
 
     map.for_each_pixel([&](float& p) {
         if (p > 0) {
@@ -46,14 +50,12 @@ image<float> add_noise_to_img(const image<float>& src, int factor) {
     return map;
 }
 
-std::pair<image<std::pair<direction, float>>, std::pair<int, int>> find_single_path_map(const image<float>& src, const int start_x, const int start_y, const int rnd) {
-    auto map = add_noise_to_img(src, rnd);
-    image<std::pair<direction, float>> path_map(map.width(), map.height());
-
-    path_map.for_each_pixel([](auto& m) {
-        m = {direction::undefined, std::numeric_limits<float>::infinity()};
-    });
-    path_map.at(start_x, start_y) = {direction::end, 0};
+std::pair<flow_field, std::pair<int, int>> find_single_path_map(const image<float>& src, const int start_x, const int start_y, const int rnd, const random_stream& stream) {
+    // the halo of map is never lower than its neighbors, so border pixels need no bounds checks
+    image<float> map(src.width(), src.height(), 0.0f, 1, std::numeric_limits<float>::infinity());
+    flow_field field(src.width(), src.height());
+    add_noise_to_img(src, rnd, stream).copy_to(map);
+    field.set_end(start_x, start_y);
 
     std::queue<std::pair<int, int>> updated_positions;
     updated_positions.push({start_x, start_y});
@@ -63,112 +65,86 @@ std::pair<image<std::pair<direction, float>>, std::pair<int, int>> find_single_p
     int dest_y;
     float dest_score = std::numeric_limits<float>::infinity();
 
-    auto check_neighbor = [&](const auto current_height, const auto current_score, const auto x, const auto y, const direction set_direction, const direction current_direction) {
-        if (auto neighbor_height = map.get(x, y)) {
-            auto& [neighbor_direction, neighbor_score] = path_map.at(x, y);
-            auto delta = std::max(0.0f, **neighbor_height - current_height);
+    const std::pair<int, int> offsets[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    const flow_direction directions[] = {flow_direction::east, flow_direction::west, flow_direction::south, flow_direction::north};
+    auto& scores = field.scores();
+
+    while (!updated_positions.empty()) {
+        auto [x, y] = updated_positions.front();
+        auto* height = map.pointer(x, y);
+        auto* score = scores.pointer(x, y);
+        auto current_score = *score;
+        auto current_height = *height;
+
+        for (int i = 0; i < 4; i++) {
+            auto [dx, dy] = offsets[i];
+            auto neighbor_height = height[map.neighbor_offset(dx, dy)];
+            auto& neighbor_score = score[scores.neighbor_offset(dx, dy)];
+            auto delta = std::max(0.0f, neighbor_height - current_height);
 
             if (current_score + delta < neighbor_score) {
-                neighbor_direction = set_direction;
+                field.set_direction(x + dx, y + dy, directions[i]);
                 neighbor_score = current_score + delta;
-                if (neighbor_score < dest_score && **neighbor_height > 0) {
-                    updated_positions.push({x, y});
+                if (neighbor_score < dest_score && neighbor_height > 0) {
+                    updated_positions.push({x + dx, y + dy});
                 }
 
-                if (**neighbor_height == 0 && neighbor_score < dest_score) {
+                if (neighbor_height == 0 && neighbor_score < dest_score) {
                     found = true;
-                    dest_x = x;
-                    dest_y = y;
+                    dest_x = x + dx;
+                    dest_y = y + dy;
                     dest_score = neighbor_score;
                 }
             }
         }
-    };
-
-    while (!updated_positions.empty()) {
-        auto [x, y] = updated_positions.front();
-        auto& [d, current_score] = path_map.at(x, y);
-        auto& current_height = map.at(x, y);
-        check_neighbor(current_height, current_score, x - 1, y, direction::east, d);
-        check_neighbor(current_height, current_score, x + 1, y, direction::west, d);
-        check_neighbor(current_height, current_score, x, y - 1, direction::south, d);
-        check_neighbor(current_height, current_score, x, y + 1, direction::north, d);
         
         updated_positions.pop();
     }
     assert(found);
 
-    return {path_map, {dest_x, dest_y}};
+    return {field, {dest_x, dest_y}};
 }
 
-std::vector<std::pair<int, int>> find_single_path(const image<float>& src, const int start_x, const int start_y, const int rnd) {
-    auto [path_map, dest_pos] = find_single_path_map(src, start_x, start_y, rnd);
+std::vector<std::pair<int, int>> find_single_path(const image<float>& src, const int start_x, const int start_y, const int rnd, const random_stream& stream) {
+    auto [field, dest_pos] = find_single_path_map(src, start_x, start_y, rnd, stream);
     auto [dest_x, dest_y] = dest_pos;
 
     std::vector<std::pair<int, int>> result;
-    while (path_map.at(dest_x, dest_y).first != direction::end) {
-        result.push_back({dest_x, dest_y});
-        auto [direction, score] = path_map.at(dest_x, dest_y);
-
-        if (direction == direction::north) {
-            dest_y--;
-        }
-        if (direction == direction::east) {
-            dest_x++;
-        }
-        if (direction == direction::south) {
-            dest_y++;
-        }
-        if (direction == direction::west) {
-            dest_x--;
-        }
-    }
-    result.push_back({dest_x, dest_y});
+    auto end = field.trace(dest_x, dest_y, [&](const int x, const int y) {
+        result.push_back({x, y});
+    });
+    result.push_back(end);
 
     return result;
 }
 
-int compute_rivers_in_region(const image<float>& region_map, const float region, const int rivers) {
-    size_t region_size = 0;
-    region_map.for_each_pixel([&](auto& p, auto x, auto y) {
-        if (p > 0 && p == region) {
-            region_size++;
-        }
-    });
-    float relative_region_size = static_cast<float>(region_size) / region_map.size();
-    int rivers_in_region = rivers * relative_region_size;
+std::vector<int> compute_rivers_per_region(const image<uint8_t>& region_map, const int regions, const int rivers) {
+    auto region_sizes = expression::reduce(execution::par, region_map, expression::label_counts<uint8_t>());
+    region_sizes.resize(std::max<size_t>(region_sizes.size(), regions + 1), 0);
 
-    return rivers_in_region;
-}
+    std::vector<int> result(regions + 1, 0);
+    for (int region = 1; region <= regions; region++) {
+        float relative_region_size = static_cast<float>(region_sizes[region]) / region_map.size();
+        result[region] = rivers * relative_region_size;
+    }
 
-std::pair<int, int> generate_river_start_point(uniform_random_number<int>& dis_x, uniform_random_number<int>& dis_y, uniform_random_number<float>& dis_dice, const image<float>& region_map, const image<float>& river_map, const image<float>& wet_map, const float region) {
-    bool retry = true;
-    int n = 0;
-    int x;
-    int y;
-    while (retry && n < 100000) {
-        x = dis_x.next();
-        y = dis_y.next();
-        auto dice = dis_dice.next();
+    return result;
+}
 
-        auto p = region_map.get(x, y);
-        auto r = river_map.get(x, y);
-        auto w = wet_map.get(x, y);
-        if (p && r && w && **p == region && **r == 0 && **w >= dice) {
-            retry = false;
+weighted_pixel_sampler generate_river_start_points(const image<uint8_t>& region_map, const image<float>& river_map, const image<half>& wet_map, const uint8_t region) {
+    // a start point used to be accepted with probability wet_map, so the weights are clamped to [0, 1]
+    return weighted_pixel_sampler(region_map.width(), region_map.height(), [&](auto x, auto y) {
+        if (region_map.at(x, y) != region || river_map.at(x, y) != 0) {
+            return 0.0f;
         }
-
-        n++;
-    }
-
-    return {x, y};
+        return std::min(1.0f, static_cast<float>(wet_map.at(x, y)));
+    });
 }
 
-void add_river_to_region(const image<float>& region_map, const float region, const int rivers, const image<float>& weights_map, image<float>& river_map, const image<float>& wet_map) {
-    random_generator rnd;
-    auto dis_x = rnd.uniform<int>(0, region_map.width());
-    auto dis_y = rnd.uniform<int>(0, region_map.height());
-    auto dis_dice = rnd.uniform<float>(0, 1.0f);
+void add_river_to_region(const image<uint8_t>& region_map, const uint8_t region, const int rivers_in_region, const image<float>& weights_map, image<float>& river_map, const image<half>& wet_map) {
+    auto stream = random_seed::stream("water.rivers", region);
+    random_generator rnd(stream.derive("start_points"));
+    auto dis = rnd.uniform<double>(0.0, 1.0);
 
     auto closed_region = weights_map.copy();
     region_map.for_each_pixel([&](auto& p, auto x, auto y) {
@@ -177,11 +153,14 @@ void add_river_to_region(const image<float>& region_map, const float region, con
         }
     });
 
-    auto rivers_in_region = compute_rivers_in_region(region_map, region, rivers);
+    auto start_points = generate_river_start_points(region_map, river_map, wet_map, region);
 
     for (int i = 0; i < rivers_in_region; i++) {
-        auto [x, y] = generate_river_start_point(dis_x, dis_y, dis_dice, region_map, river_map, wet_map, region);
-        auto track = find_single_path(closed_region, x, y, 3);
+        auto start = start_points.draw(dis.next());
+        if (!start) {
+            break;
+        }
+        auto track = find_single_path(closed_region, start->first, start->second, 3, stream.derive(i));
         if (i == 0) {
             closed_region.for_each_pixel([&](auto& p, auto x, auto y) {
                 if (p < 0.1) {
@@ -193,28 +172,24 @@ void add_river_to_region(const image<float>& region_map, const float region, con
         for (const auto& [pos_x, pos_y] : track) {
             river_map.at(pos_x, pos_y) = region;
             closed_region.at(pos_x, pos_y) = 0;
+            start_points.set_weight(pos_x, pos_y, 0.0f);
         }
     }
 }
 
-image<float> generate_river_distribution(const image<float>& mask) {
-    auto result = mask_to_regions(mask, 10000);
-    std::unordered_map<float, float> conversion;
+image<float> generate_river_distribution(const image<uint8_t>& mask) {
+    auto [labels, regions] = mask_to_regions(mask, 10000, random_seed::stream("water.distribution"));
 
-    result.for_each_pixel([&](auto& p) {
-        conversion[p] = 0.0f;
-    });
-
-    for (auto& [key, value] : conversion) {
-        value = random_float(0.0f, 1.0f);
+    // the wetness of a region only depends on its id
+    auto wetness = random_seed::stream("water.wetness");
+    std::vector<float> conversion(regions.size() + 1, 0.0f);
+    for (const auto& region : regions) {
+        conversion[region.id] = uniform_float(wetness.at(region.id), 0.0f, 1.0f);
     }
 
-    conversion[0] = 0.0f;
-    result.for_each_pixel([&](auto& p) {
-        p = conversion[p];
-    });
+    auto result = remap(execution::par, labels, conversion);
 
-    auto ocean_distance = generate_ocean_distance_map(result);
+    const auto ocean_distance = generate_ocean_distance_map(result);
 
     result.for_each_pixel([&](auto& p, auto x, auto y) {
         auto d = ocean_distance.at(x, y);
@@ -267,45 +242,35 @@ std::pair<image<float>, image<float>> generate_river_depth(const image<float>& r
     auto copy = weights.copy();
     auto copy2 = weights.copy();
 
-    float max = 0;
-    levels.for_each_pixel([&](auto& p, int x, int y) {
+    // log is monotonic, so the largest logarithm is the logarithm of the largest level
+    float max = std::max(0.0f, std::log(expression::reduce(execution::par, levels, expression::maximum<float>{0.0f})));
+
+    levels.assign(execution::par, expression::map(levels, [max](float p) {
         if (p > 0) {
             p = std::log(p);
-            max = std::max(max, p);
         }
-    });
-
-    levels.for_each_pixel([&](auto& p, int x, int y) {
         if (p > 0) {
             p = 1.0f + (p / max) * 64;
         }
-    });
+        return p;
+    }));
 
     levels.for_each_pixel([&](auto& p, int x, int y) {
         if (p > 0) {
             apply_circular_set(levels, -1.0f * p, circles.at(p), x, y);
-            apply_circular_set(heights, -1.0f * heights.at(x, y), circles.at(p), x, y);
+            apply_circular_set(heights, -1.0f * std::as_const(heights).at(x, y), circles.at(p), x, y);
         }
     });
 
+    // heights is only read at the pixel itself, so it needs no pass of its own
     levels.for_each_pixel([&](auto& p, int x, int y) {
         p = std::abs(p);
-    });
-    heights.for_each_pixel([&](auto& p, int x, int y) {
-        p = std::abs(p);
-    });
-
-    levels.for_each_pixel([&](auto p, int x, int y) {
         if (p > 0) {
-            copy2.at(x, y) = heights.at(x, y);
-            if (copy2.at(x, y) > 0.1) {
+            auto h = std::abs(std::as_const(heights).at(x, y));
+            copy2.at(x, y) = h;
+            if (h > 0.1) {
                 apply_circular_shift(copy, copy2, circles.at(p), x, y);
             }
-        }
-    });
-
-    levels.for_each_pixel([&](auto& p, int x, int y) {
-        if (p > 0) {
             p = 1.0f;
         } else {
             p = 0.0f;
@@ -316,15 +281,20 @@ std::pair<image<float>, image<float>> generate_river_depth(const image<float>& r
 }
 
 void filter_non_zero_neighbors(image<float>& water, const image<float>& terrain) {
+    image<float> padded(terrain.width(), terrain.height(), 0.0f, 1, 0.0f);
+    terrain.copy_to(padded);
+
+    auto top = padded.neighbor_offset(0, -1);
+    auto bot = padded.neighbor_offset(0, 1);
+    auto left = padded.neighbor_offset(-1, 0);
+    auto right = padded.neighbor_offset(1, 0);
+
     water.for_each_pixel([&](auto& p, auto x, auto y) {
-        auto top = terrain.get(x, y - 1);
-        auto bot = terrain.get(x, y + 1);
-        auto left = terrain.get(x - 1, y);
-        auto right = terrain.get(x + 1, y);
+        const auto* t = std::as_const(padded).pointer(x, y);
 
-        bool has_non_zero_neighbor = (top && **top > 0) || (bot && **bot > 0) || (left && **left > 0) || (right && **right > 0);
+        bool has_non_zero_neighbor = t[top] > 0 || t[bot] > 0 || t[left] > 0 || t[right] > 0;
 
-        if (p > 0 && terrain.at(x, y) == 0 && !has_non_zero_neighbor) {
+        if (p > 0 && *t == 0 && !has_non_zero_neighbor) {
             p = 0.0f;
         }
     });
@@ -332,21 +302,22 @@ void filter_non_zero_neighbors(image<float>& water, const image<float>& terrain)
 
 image<std::pair<float, float>> generate_water_scale_cell_position(const image<float>& water, const size_t width, const size_t height) {
     image<std::pair<float, float>> scaled_water_pos(water.width(), water.height());
+    auto stream = random_seed::stream("water.cell_positions");
 
     water.for_each_pixel([&](auto& p, auto x, auto y) {
         auto scale_x = static_cast<float>(width) / water.width();
         auto scale_y = static_cast<float>(height) / water.height();
 
-        float set_right = random_float(0, 1.0);
-        float set_bot = random_float(0, 1.0);
+        float set_right = random_float(stream, 0, 1.0);
+        float set_bot = random_float(stream, 0, 1.0);
 
         if (auto right = water.get(x + 1, y)) {
             if (auto bot = water.get(x, y + 1)) {
                 if (**right == p && **bot == p) {
                     if (set_right <= 0.5) {
-                        set_bot = random_float(0.0, 0.5);
+                        set_bot = random_float(stream, 0.0, 0.5);
                     } else {
-                        set_bot = random_float(0.5, 1.0);
+                        set_bot = random_float(stream, 0.5, 1.0);
                     }
                 }
             }
@@ -357,9 +328,9 @@ image<std::pair<float, float>> generate_water_scale_cell_position(const image<fl
 
             if (water.at(x, y - 1) == p) {
                 if (local_bot <= 0.5) {
-                    set_right = random_float(0.5, 1.0);
+                    set_right = random_float(stream, 0.5, 1.0);
                 } else {
-                    set_right = random_float(0, 0.5);
+                    set_right = random_float(stream, 0, 0.5);
                 }
             }
         }
@@ -368,9 +339,9 @@ image<std::pair<float, float>> generate_water_scale_cell_position(const image<fl
 
             if (water.at(x - 1, y) == p) {
                 if (local_right <= 0.5) {
-                    set_bot = random_float(0.5, 1.0);
+                    set_bot = random_float(stream, 0.5, 1.0);
                 } else {
-                    set_bot = random_float(0, 0.5);
+                    set_bot = random_float(stream, 0, 0.5);
                 }
             }
         }
@@ -387,6 +358,7 @@ image<std::pair<float, float>> generate_water_scale_cell_position(const image<fl
 std::pair<image<float>, std::vector<std::pair<size_t, size_t>>> upscale_river_map(const image<float>& river_map, const image<float>& terrain, const size_t width, const size_t height) {
     image<float> scaled_rivers(width, height);
     auto positions = generate_water_scale_cell_position(river_map, width, height);
+    auto lines = random_seed::stream("water.lines");
 
     auto check_water_manhatten = [&](auto x, auto y, auto p) {
         if (auto neighbor = river_map.get(x, y)) {
@@ -438,45 +410,45 @@ std::pair<image<float>, std::vector<std::pair<size_t, size_t>>> upscale_river_ma
 
         int cross = 0;
         if (top >= 0 && bot >= 0) {
-            draw_random_manhattan_line(scaled_rivers, top_x, top_y, bot_x, bot_y, p);
+            draw_random_manhattan_line(scaled_rivers, top_x, top_y, bot_x, bot_y, p, lines);
             cross++;
         }
         if (left >= 0 && right >= 0) {
-            draw_random_manhattan_line(scaled_rivers, left_x, left_y, right_x, right_y, p);
+            draw_random_manhattan_line(scaled_rivers, left_x, left_y, right_x, right_y, p, lines);
             cross++;
         }
         if (top >= 0 && left >= 0 && cross < 2) {
-            draw_random_manhattan_line(scaled_rivers, top_x, top_y, left_x, left_y, p);
+            draw_random_manhattan_line(scaled_rivers, top_x, top_y, left_x, left_y, p, lines);
         }
         if (top >= 0 && right >= 0 && cross < 2 && left < 0) {
-            draw_random_manhattan_line(scaled_rivers, top_x, top_y, right_x, right_y, p);
+            draw_random_manhattan_line(scaled_rivers, top_x, top_y, right_x, right_y, p, lines);
         }
         if (bot >= 0 && left >= 0 && cross < 2 && top < 0) {
-            draw_random_manhattan_line(scaled_rivers, bot_x, bot_y, left_x, left_y, p);
+            draw_random_manhattan_line(scaled_rivers, bot_x, bot_y, left_x, left_y, p, lines);
         }
         if (bot >= 0 && right >= 0 && cross < 2 && top < 0 && left < 0) {
-            draw_random_manhattan_line(scaled_rivers, bot_x, bot_y, right_x, right_y, p);
+            draw_random_manhattan_line(scaled_rivers, bot_x, bot_y, right_x, right_y, p, lines);
         }
         if (top >= 0 && bot < 0 && right < 0 && left < 0) {
-            draw_random_manhattan_line(scaled_rivers, top_x, top_y, center_x, center_y, p);
+            draw_random_manhattan_line(scaled_rivers, top_x, top_y, center_x, center_y, p, lines);
             if (terrain.at(x, y) == 0) {
                 end_points.push_back({center_x, center_y});
             }
         }
         if (top < 0 && bot >= 0 && right < 0 && left < 0) {
-            draw_random_manhattan_line(scaled_rivers, bot_x, bot_y, center_x, center_y, p);
+            draw_random_manhattan_line(scaled_rivers, bot_x, bot_y, center_x, center_y, p, lines);
             if (terrain.at(x, y) == 0) {
                 end_points.push_back({center_x, center_y});
             }
         }
         if (top < 0 && bot < 0 && right >= 0 && left < 0) {
-            draw_random_manhattan_line(scaled_rivers, right_x, right_y, center_x, center_y, p);
+            draw_random_manhattan_line(scaled_rivers, right_x, right_y, center_x, center_y, p, lines);
             if (terrain.at(x, y) == 0) {
                 end_points.push_back({center_x, center_y});
             }
         }
         if (top < 0 && bot < 0 && right < 0 && left >= 0) {
-            draw_random_manhattan_line(scaled_rivers, left_x, left_y, center_x, center_y, p);
+            draw_random_manhattan_line(scaled_rivers, left_x, left_y, center_x, center_y, p, lines);
             if (terrain.at(x, y) == 0) {
                 end_points.push_back({center_x, center_y});
             }
@@ -488,7 +460,7 @@ std::pair<image<float>, std::vector<std::pair<size_t, size_t>>> upscale_river_ma
 
 std::vector<std::pair<int, int>> compute_lake_position(const image<float>& rivers) {
     std::vector<std::pair<int, int>> lake_position;
-    auto lake_dis = random_generator().uniform<float>(0, 10000.0);
+    auto lake_dis = random_generator(random_seed::stream("water.lake_positions")).uniform<float>(0, 10000.0);
     rivers.for_each_pixel([&](auto p, int x, int y) {
         if (p > 0) {
             auto dice = lake_dis.next();        
@@ -503,38 +475,29 @@ std::vector<std::pair<int, int>> compute_lake_position(const image<float>& river
 
 void apply_lakes(const image<float>& river_map, const std::vector<std::pair<image<float>, image<float>>>& shapes, image<float>& scaled_river_map, image<float>& terrain) {
     auto lake_position = compute_lake_position(river_map);
-    random_generator rnd;
+    random_generator rnd(random_seed::stream("water.lakes"));
     auto lake_shape_dis = rnd.uniform<int>(0, shapes.size() - 1);
     auto lake_size_dis = rnd.uniform<int>(2, 256);
     for (auto [lake_x, lake_y] : lake_position) {
         auto index = lake_shape_dis.next();
         auto [mask, weights] = shapes[index];
         auto size = std::min(lake_size_dis.next(), static_cast<int>(mask.width()));
-        auto lake_shape = mask.rescale(std::max(2, size), std::max(2.0f, (static_cast<float>(mask.height()) / mask.width()) * size));
-        lake_shape = resize_and_center(lake_shape, lake_shape.width() + 128, lake_shape.height() + 128);
+        auto scaled_shape = mask.rescale(std::max(2, size), std::max(2.0f, (static_cast<float>(mask.height()) / mask.width()) * size));
+        const auto lake_shape = resize_and_center(scaled_shape, scaled_shape.width() + 128, scaled_shape.height() + 128);
 
         auto lake_shape_connector_x = rnd.uniform<int>(0, lake_shape.width() - 1);
         auto lake_shape_connector_y = rnd.uniform<int>(0, lake_shape.height() - 1);
         int connector_x = 0;
         int connector_y = 0;
 
-        auto lake_slope_shape = lake_shape.copy();
-        lake_slope_shape.for_each_pixel([&](auto& p) {
-            if (p > 0) {
-                p = 0.0f;
-            } else {
-                p = 1.0f;
-            }
+        auto lake_outside = lake_shape.convert<uint8_t>([](float p) {
+            return p > 0 ? 0 : 1;
         });
-        auto lake_slope_distance = generate_ocean_distance_map(lake_slope_shape);
-        lake_slope_distance.for_each_pixel([&](int p, auto x, auto y) {
-            float s;
+        const auto lake_slope_shape = distance_transform(lake_outside, distance_metric::manhattan).convert<float>([](float p) {
             if (p > 64) {
-                s = 0.0f;
-            } else {
-                s = 1.0f - p / 64.0f;
+                return 0.0f;
             }
-             lake_slope_shape.at(x, y) = s;
+            return 1.0f - p / 64.0f;
         });
 
         int n = 0;
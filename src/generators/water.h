@@ -4,37 +4,33 @@
 #include <queue>
 #include <unordered_map>
 
+#include "flow_field.h"
+#include "half.h"
 #include "image.h"
 #include "random_generator.h"
+#include "sampler.h"
 
 namespace mapgen::generators::water {
 
-std::pair<image<float>, image<float>> generate(const image<float>& mask, const image<float>& terrain, const std::vector<std::pair<image<float>, image<float>>>& shapes);
+std::pair<image<float>, image<float>> generate(const image<uint8_t>& mask, const image<float>& terrain, const std::vector<std::pair<image<float>, image<float>>>& shapes);
 
 namespace internal {
 
-enum direction {
-    end,
-    north,
-    east,
-    south,
-    west,
-    undefined
-};
+image<float> add_noise_to_img(const image<float>& src, int factor, const random_stream& stream);
 
-image<float> add_noise_to_img(const image<float>& src, int factor);
+std::pair<flow_field, std::pair<int, int>> find_single_path_map(const image<float>& src, const int start_x, const int start_y, const int rnd, const random_stream& stream);
 
-std::pair<image<std::pair<direction, float>>, std::pair<int, int>> find_single_path_map(const image<float>& src, const int start_x, const int start_y, const int rnd);
+std::vector<std::pair<int, int>> find_single_path(const image<float>& src, const int start_x, const int start_y, const int rnd, const random_stream& stream);
 
-std::vector<std::pair<int, int>> find_single_path(const image<float>& src, const int start_x, const int start_y, const int rnd);
+// splits rivers between the regions 1 to regions by their size, indexed by region
+std::vector<int> compute_rivers_per_region(const image<uint8_t>& region_map, const int regions, const int rivers);
 
-int compute_rivers_in_region(const image<float>& region_map, const float region, const int rivers);
+// pixels of region without a river, weighted by wet_map
+weighted_pixel_sampler generate_river_start_points(const image<uint8_t>& region_map, const image<float>& river_map, const image<half>& wet_map, const uint8_t region);
 
-std::pair<int, int> generate_river_start_point(uniform_random_number<int>& dis_x, uniform_random_number<int>& dis_y, uniform_random_number<float>& dis_dice, const image<float>& region_map, const image<float>& river_map, const image<float>& wet_map, const float region);
+void add_river_to_region(const image<uint8_t>& region_map, const uint8_t region, const int rivers_in_region, const image<float>& weights_map, image<float>& river_map, const image<half>& wet_map);
 
-void add_river_to_region(const image<float>& region_map, const float region, const int rivers, const image<float>& weights_map, image<float>& river_map, const image<float>& wet_map);
-
-image<float> generate_river_distribution(const image<float>& mask);
+image<float> generate_river_distribution(const image<uint8_t>& mask);
 
 void apply_circular_shift(image<float>& target, const image<float>& map, const image<float>& circle, const int x, const int y);
 
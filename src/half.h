@@ -0,0 +1,92 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// 16 bit IEEE 754 half precision float, a storage type only: arithmetic happens on float,
+// values are rounded to the nearest half (ties to even) when stored
+// halves have about 3 significant decimal digits, enough for height and probability maps in [0, 1]
+class half {
+public:
+    half() = default;
+    half(const float value) : m_bits(from_float(value)) {}
+
+    operator float() const {
+        return to_float(m_bits);
+    }
+
+    static half from_bits(const uint16_t bits) {
+        half result;
+        result.m_bits = bits;
+        return result;
+    }
+    uint16_t bits() const {
+        return m_bits;
+    }
+private:
+    static uint16_t from_float(const float value) {
+        auto bits = std::bit_cast<uint32_t>(value);
+        uint16_t sign = (bits >> 16) & 0x8000;
+        uint32_t magnitude = bits & 0x7fffffff;
+
+        // infinity and nan, nan stays quiet
+        if (magnitude >= 0x7f800000) {
+            return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+        }
+        // everything from 65520 on rounds to infinity
+        if (magnitude >= 0x477ff000) {
+            return sign | 0x7c00;
+        }
+        // below 2^-14 the result is subnormal, scaling by 2^24 is exact and rint rounds to even
+        if (magnitude < 0x38800000) {
+            return sign | static_cast<uint16_t>(std::rint(std::bit_cast<float>(magnitude) * 16777216.0f));
+        }
+
+        uint32_t rounded = magnitude + 0xfff + ((magnitude >> 13) & 1);
+        return sign | ((rounded - 0x38000000) >> 13);
+    }
+    static float to_float(const uint16_t bits) {
+        uint32_t sign = static_cast<uint32_t>(bits & 0x8000) << 16;
+        uint32_t exponent = (bits >> 10) & 0x1f;
+        uint32_t mantissa = bits & 0x3ff;
+
+        if (exponent == 0) {
+            return std::bit_cast<float>(sign | std::bit_cast<uint32_t>(mantissa / 16777216.0f));
+        }
+        if (exponent == 0x1f) {
+            return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+        }
+
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+
+    uint16_t m_bits;
+};
+
+template<>
+class std::numeric_limits<half> {
+public:
+    constexpr static const bool is_specialized = true;
+    constexpr static const bool is_signed = true;
+    constexpr static const bool is_integer = false;
+    constexpr static const bool has_infinity = true;
+    constexpr static const int digits = 11;
+
+    static half min() {
+        return half::from_bits(0x0400);
+    }
+    static half max() {
+        return half::from_bits(0x7bff);
+    }
+    static half lowest() {
+        return half::from_bits(0xfbff);
+    }
+    static half epsilon() {
+        return half::from_bits(0x1400);
+    }
+    static half infinity() {
+        return half::from_bits(0x7c00);
+    }
+};
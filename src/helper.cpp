@@ -1,5 +1,10 @@
 #include "helper.h"
 
+#include <cassert>
+
+#include "image_expression.h"
+#include "sampler.h"
+
 float calc_distance(const int x, const int y, const int half_size, const int i, const int j) {
     int diff_x = x - (x - half_size + i);
     int diff_y = y - (y - half_size + j);
@@ -7,46 +12,357 @@ float calc_distance(const int x, const int y, const int half_size, const int i,
     return std::sqrt(diff_x * diff_x + diff_y * diff_y);
 }
 
-void add_gaussian_blur(image<float>& img) {
-    image<float> copy(img.width(), img.height(), 0.0);
-    std::vector<int> kernel = {1, 2, 1, 2, 4, 2, 1, 2, 1};
-
-    for (int j = 1; j < copy.height() - 1; j++) {
-        for (int i = 0; i < copy.width(); i++) {
-            int i_is_first = static_cast<int>(i == 0);
-            int i_is_last = static_cast<int>(i == copy.width() - 1);
-            int j_is_first = static_cast<int>(j == 0);
-            int j_is_last = static_cast<int>(j == copy.height() - 1);
-
-            int w = j_is_first * 3;
-            float factor = 0.0;
-            for (int kj = -1 + j_is_first; kj <= 1 - j_is_last; kj++) {
-                w += i_is_first;
-                for (int ki = -1 + i_is_first; ki <= 1 - i_is_last; ki++) {
-                    copy.at(i, j) += img.at(i + ki, j + kj) * kernel[w];
-                    factor += kernel[w];
-                    w++;
+namespace {
+
+// up to this many iterations the repeated 3x3 blur is applied exactly in one pass per axis, beyond
+// it a cascade of gaussian_blur_boxes box blurs with the same variance approximates it in O(1) per
+// pixel
+constexpr int gaussian_blur_exact_iterations = 32;
+constexpr int gaussian_blur_boxes = 4;
+
+// n 3x3 blurs along an axis of the given length as one matrix: a single blur is the tridiagonal
+// matrix r with the rows [1 2 1] / 4 and [2 1] / 3 at both ends, n blurs are r^n, which is the
+// binomial kernel of 2n + 1 taps except for the n rows next to each end, those are kept explicitly
+class iterated_blur {
+public:
+    iterated_blur(const size_t length, const int n) : m_length(length), m_n(n) {
+        // on short axes every row touches an end
+        if (length <= 2 * static_cast<size_t>(n) + 1) {
+            m_border = length;
+            m_near = power_rows(length, length);
+            return;
+        }
+
+        m_border = n;
+        // the first n rows of r^n only reach the inputs [0, 2n), so an axis of 2n + 1 has the same ones
+        m_near = power_rows(2 * n + 1, n);
+        for (const auto& row : m_near) {
+            m_far.emplace_back(row.rbegin(), row.rend());
+        }
+        double weight = 1.0 / std::pow(4.0, n);
+        for (int k = 0; k <= 2 * n; k++) {
+            m_kernel.push_back(weight);
+            weight = weight * (2 * n - k) / (k + 1);
+        }
+    }
+
+    // output i = sum of weights(i)[k] * input[first(i) + k]
+    size_t first(const size_t i) const {
+        if (i < m_border) {
+            return 0;
+        }
+        if (i >= m_length - m_border) {
+            return m_length - m_far[m_length - 1 - i].size();
+        }
+        return i - m_n;
+    }
+    const std::vector<float>& weights(const size_t i) const {
+        if (i < m_border) {
+            return m_near[i];
+        }
+        if (i >= m_length - m_border) {
+            return m_far[m_length - 1 - i];
+        }
+        return m_kernel;
+    }
+    // the outputs in [border(), length - border()) all use the binomial kernel
+    size_t border() const {
+        return m_border;
+    }
+private:
+    // the first rows of r^n on an axis of length, without the zero weights past the last input
+    // they reach
+    std::vector<std::vector<float>> power_rows(const size_t length, const size_t rows) const {
+        std::vector<std::vector<float>> result;
+        std::vector<double> v(length);
+        std::vector<double> next(length);
+
+        for (size_t i = 0; i < rows; i++) {
+            std::fill(v.begin(), v.end(), 0.0);
+            v[i] = 1.0;
+            for (int step = 0; step < m_n && length > 1; step++) {
+                // next = v * r
+                std::fill(next.begin(), next.end(), 0.0);
+                for (size_t k = 0; k < length; k++) {
+                    if (k == 0) {
+                        next[0] += v[0] * 2.0 / 3.0;
+                        next[1] += v[0] / 3.0;
+                    } else if (k == length - 1) {
+                        next[k] += v[k] * 2.0 / 3.0;
+                        next[k - 1] += v[k] / 3.0;
+                    } else {
+                        next[k - 1] += v[k] / 4.0;
+                        next[k] += v[k] / 2.0;
+                        next[k + 1] += v[k] / 4.0;
+                    }
                 }
-                w += i_is_last;
+                std::swap(v, next);
             }
-            copy.at(i, j) /= factor;
+            result.emplace_back(v.begin(), v.begin() + std::min<size_t>(length, i + m_n + 1));
         }
+
+        return result;
     }
 
-    img = std::move(copy);
+    size_t m_length;
+    int m_n;
+    size_t m_border;
+    // rows next to the first and next to the last input, m_far[i] belongs to output length - 1 - i
+    std::vector<std::vector<float>> m_near;
+    std::vector<std::vector<float>> m_far;
+    std::vector<float> m_kernel;
+};
+
+// dest = src blurred along the row, the interior is a weighted sum of shifted copies of src
+void iterated_blur_row(float* dest, const float* src, const iterated_blur& blur, const size_t width, std::vector<const float*>& shifted) {
+    auto border = blur.border();
+    for (size_t x = 0; x < width; x++) {
+        if (x == border && width > 2 * border) {
+            x = width - border;
+        }
+        const auto& weights = blur.weights(x);
+        const float* s = src + blur.first(x);
+        float sum = 0.0f;
+        for (size_t k = 0; k < weights.size(); k++) {
+            sum += weights[k] * s[k];
+        }
+        dest[x] = sum;
+    }
+
+    if (width <= 2 * border) {
+        return;
+    }
+    const auto& kernel = blur.weights(border);
+    shifted.resize(kernel.size());
+    for (size_t k = 0; k < kernel.size(); k++) {
+        shifted[k] = src + k;
+    }
+    simd::weighted_sum(dest + border, shifted.data(), kernel.data(), kernel.size(), width - 2 * border);
 }
 
-void scale_range(image<float>& img) {
-    float min = MAXFLOAT;
-    float max = 0;
+// widths of boxes whose cascade has the variance sigma2, see Kovesi, "Fast Almost-Gaussian Filtering"
+std::vector<int> gaussian_box_widths(const double sigma2, const int boxes) {
+    int lower = std::sqrt(12.0 * sigma2 / boxes + 1.0);
+    if (lower % 2 == 0) {
+        lower--;
+    }
+    int upper = lower + 2;
+    int lower_boxes = std::round((12.0 * sigma2 - boxes * lower * lower - 4.0 * boxes * lower - 3.0 * boxes) / (-4.0 * lower - 4.0));
+
+    std::vector<int> widths;
+    for (int i = 0; i < boxes; i++) {
+        widths.push_back(i < lower_boxes ? lower : upper);
+    }
+
+    return widths;
+}
+
+// boxes that reach over the ends of the row are cut off and renormalized like the 3x3 kernel
+void box_blur_row(float* row, const size_t width, const std::vector<int>& widths, std::vector<double>& prefix) {
+    prefix.resize(width + 1);
+
+    for (auto box : widths) {
+        int radius = box / 2;
+        prefix[0] = 0.0;
+        for (size_t x = 0; x < width; x++) {
+            prefix[x + 1] = prefix[x] + row[x];
+        }
+        for (int x = 0; x < static_cast<int>(width); x++) {
+            int begin = std::max(0, x - radius);
+            int end = std::min(static_cast<int>(width), x + radius + 1);
+            row[x] = (prefix[end] - prefix[begin]) / (end - begin);
+        }
+    }
+}
+
+// same for the columns [x_begin, x_end), the boxes run alternately from a into b and back,
+// the result ends up in a for an even number of boxes and in b otherwise
+void box_blur_columns(image<float>& a, image<float>& b, const size_t x_begin, const size_t x_end, const std::vector<int>& widths) {
+    int height = a.height();
+    std::vector<double> sum(x_end - x_begin);
+    image<float>* src = &a;
+    image<float>* dest = &b;
 
-    img.for_each_pixel([&](float& f) {
-        min = std::min<float>(min, f);
-        max = std::max<float>(max, f);
+    auto add_row = [&](const int y, const double factor) {
+        if (y < 0 || y >= height) {
+            return;
+        }
+        const float* s = std::as_const(*src).pointer(x_begin, y);
+        for (size_t x = 0; x < sum.size(); x++) {
+            sum[x] += factor * s[x];
+        }
+    };
+
+    for (auto box : widths) {
+        int radius = box / 2;
+        std::fill(sum.begin(), sum.end(), 0.0);
+        for (int k = 0; k < radius; k++) {
+            add_row(k, 1.0);
+        }
+        for (int y = 0; y < height; y++) {
+            add_row(y + radius, 1.0);
+            add_row(y - radius - 1, -1.0);
+            int count = std::min(height, y + radius + 1) - std::max(0, y - radius);
+            float* d = dest->pointer(x_begin, y);
+            for (size_t x = 0; x < sum.size(); x++) {
+                d[x] = sum[x] / count;
+            }
+        }
+        std::swap(src, dest);
+    }
+}
+
+}
+
+// separable [1 2 1] / 4 kernel, cut off and renormalized to [2 1] / 3 at the borders: the rows
+// are blurred into a scratch image, the columns from there back into img
+template<typename layout_T>
+void add_gaussian_blur(image<float, layout_T>& img) {
+    auto width = img.width();
+    auto height = img.height();
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    // a thread waiting for the bands below runs other jobs, which may blur another image on this
+    // thread, so every call has its own scratch image, its buffer comes from the pool of image_storage
+    image<float> rows(width, height, image_init::uninitialized);
+    const auto& src = std::as_const(img);
+
+    rows.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+        std::vector<float> line;
+        for (size_t y = begin; y < end; y++) {
+            if constexpr (image<float, layout_T>::contiguous_rows) {
+                simd::blur3(rows.row(y).data(), src.row(y).data(), width);
+            } else {
+                line.resize(width);
+                for (size_t x = 0; x < width; x++) {
+                    line[x] = src.at(x, y);
+                }
+                simd::blur3(rows.row(y).data(), line.data(), width);
+            }
+        }
+    });
+
+    // detach img once here, the bands below only write their own rows
+    img.data();
+
+    img.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+        std::vector<float> line(image<float, layout_T>::contiguous_rows ? 0 : width);
+        for (size_t y = begin; y < end; y++) {
+            float* dest = line.data();
+            if constexpr (image<float, layout_T>::contiguous_rows) {
+                dest = img.row(y).data();
+            }
+
+            const float* center = std::as_const(rows).row(y).data();
+            if (height == 1) {
+                std::copy_n(center, width, dest);
+            } else if (y == 0) {
+                simd::blur2_rows(dest, center, center + width, width);
+            } else if (y == height - 1) {
+                simd::blur2_rows(dest, center, center - width, width);
+            } else {
+                simd::blur3_rows(dest, center - width, center, center + width, width);
+            }
+
+            if constexpr (!image<float, layout_T>::contiguous_rows) {
+                for (size_t x = 0; x < width; x++) {
+                    img.at(x, y) = line[x];
+                }
+            }
+        }
     });
-    img.for_each_pixel([&](float& f) {
-        f = (f - min) * (1.0 / (max - min));
+}
+
+template void add_gaussian_blur(image<float, row_major_layout>& img);
+template void add_gaussian_blur(image<float, tiled_layout<>>& img);
+
+template<typename layout_T>
+void add_gaussian_blur(image<float, layout_T>& img, const int iterations) {
+    auto width = img.width();
+    auto height = img.height();
+    if (iterations <= 0 || width == 0 || height == 0) {
+        return;
+    }
+
+    image<float> rows(width, height, image_init::uninitialized);
+    image<float> columns(width, height, image_init::uninitialized);
+
+    if (iterations <= gaussian_blur_exact_iterations) {
+        iterated_blur horizontal(width, iterations);
+        iterated_blur vertical(height, iterations);
+
+        rows.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+            std::vector<float> line(width);
+            std::vector<const float*> shifted;
+            for (size_t y = begin; y < end; y++) {
+                const float* src = line.data();
+                if constexpr (image<float, layout_T>::contiguous_rows) {
+                    src = std::as_const(img).row(y).data();
+                } else {
+                    for (size_t x = 0; x < width; x++) {
+                        line[x] = std::as_const(img).at(x, y);
+                    }
+                }
+                iterated_blur_row(rows.row(y).data(), src, horizontal, width, shifted);
+            }
+        });
+
+        // every output row is the weighted sum of the rows its weights cover
+        columns.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+            std::vector<const float*> sources;
+            for (size_t y = begin; y < end; y++) {
+                const auto& weights = vertical.weights(y);
+                sources.resize(weights.size());
+                for (size_t k = 0; k < weights.size(); k++) {
+                    sources[k] = std::as_const(rows).row(vertical.first(y) + k).data();
+                }
+                simd::weighted_sum(columns.row(y).data(), sources.data(), weights.data(), weights.size(), width);
+            }
+        });
+
+        if constexpr (std::is_same_v<layout_T, row_major_layout>) {
+            img = std::move(columns);
+        } else {
+            columns.copy_to(execution::par, img);
+        }
+        return;
+    }
+
+    auto widths = gaussian_box_widths(iterations / 2.0, gaussian_blur_boxes);
+
+    rows.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+        std::vector<double> prefix;
+        for (size_t y = begin; y < end; y++) {
+            auto row = rows.row(y);
+            for (size_t x = 0; x < width; x++) {
+                row[x] = std::as_const(img).at(x, y);
+            }
+            box_blur_row(row.data(), width, widths, prefix);
+        }
+    });
+
+    thread_pool::shared().for_each_band(width, [&](auto band, auto begin, auto end) {
+        box_blur_columns(rows, columns, begin, end, widths);
     });
+
+    auto& result = widths.size() % 2 == 1 ? columns : rows;
+    if constexpr (std::is_same_v<layout_T, row_major_layout>) {
+        img = std::move(result);
+    } else {
+        result.copy_to(execution::par, img);
+    }
+}
+
+template void add_gaussian_blur(image<float, row_major_layout>& img, const int iterations);
+template void add_gaussian_blur(image<float, tiled_layout<>>& img, const int iterations);
+
+void scale_range(image<float>& img) {
+    auto [min, max] = expression::reduce(execution::par, img, expression::minmax<float>());
+    max = std::max(0.0f, max);
+
+    img.shift_and_scale(execution::par, -min, range_factor(min, max));
 }
 
 
@@ -85,23 +401,30 @@ image<float> extract_background(const image<float>& img, const float threshold)
     return extract_non_zero_region(base_background);
 }
 
-std::vector<int> generate_grayscale_histogram(const image<float>& img) {
-    std::vector<int> histogram(256);
+namespace {
 
-    img.for_each_pixel([&](auto& p) {
-        if (p <= 1.0) {
-            histogram[p * 255]++;            
+// the bins of generate_grayscale_histogram: p falls into the bin p * 255, so only 1 itself reaches
+// the last bin, apply_relative_threshold relies on it
+struct grayscale_histogram : expression::histogram<float> {
+    void accumulate(value_type& result, const float& p) const {
+        if (p < 0.0f || p > 1.0f) {
+            return;
         }
-    });
+        result[static_cast<size_t>(p * 255)]++;
+    }
+};
 
-    return histogram;
+}
+
+std::vector<size_t> generate_grayscale_histogram(const image<float>& img) {
+    return expression::reduce(execution::par, img, grayscale_histogram{{256, 0.0f, 1.0f}});
 }
 
 void apply_relative_threshold(image<float>& img, const float factor) {
     int threshold = 255;
-    int sum = 0;
+    size_t sum = 0;
 
-    std::vector<int> histogram = generate_grayscale_histogram(img);
+    auto histogram = generate_grayscale_histogram(img);
 
     while (img.width() * img.height() * factor > sum && threshold >= 0) {
         sum += histogram[threshold];
@@ -116,7 +439,7 @@ void apply_relative_threshold(image<float>& img, const float factor) {
 }
 
 void apply_circular_fade_out(image<float>& img, const float factor) {
-    img.for_each_pixel([&](auto& p, auto x, auto y) {
+    img.for_each_pixel(execution::par, [&](auto& p, auto x, auto y) {
         auto dx = std::abs(static_cast<int>(x) - static_cast<int>(img.width()) / 2);
         auto dy = std::abs(static_cast<int>(y) - static_cast<int>(img.height()) / 2);
         auto distance = std::sqrt(dx * dx + dy * dy);
@@ -132,98 +455,71 @@ void apply_circular_fade_out(image<float>& img, const float factor) {
     });
 }
 
-void apply_relative_noise(image<float>& img, const float factor) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis_noice(0, 10);
-
-    img.for_each_pixel([&](float& p) {
+void apply_relative_noise(image<float>& img, const float factor, const random_stream& stream) {
+    // the noise of a pixel only depends on its index, so the bands can run in parallel
+    img.for_each_pixel(execution::par, [&](float& p, auto x, auto y) {
         if (p > 0) {
-            p = p + p * (dis_noice(gen) * factor);
+            p = p + p * (stream.at(y * img.width() + x) % 11 * factor);
         }
     });
 
     scale_range(img);
 }
 
-image<float> mask_to_regions(const image<float>& image, const int regions) {
+template<typename T>
+voronoi_diagram mask_to_regions(const image<T>& image, const int regions, const random_stream& stream) {
     voronoi_generator v;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis_x(0, image.width());
-    std::uniform_int_distribution<int> dis_y(0, image.height());
+    random_generator rnd(stream);
+    auto dis = rnd.uniform<double>(0.0, 1.0);
 
+    pixel_sampler sites(image.width(), image.height(), [&](auto x, auto y) {
+        return image.at(x, y) != 0;
+    });
     for (int i = 0; i < regions; i++) {
-        bool retry = true;
-        int n = 0;
-
-        while (retry && n < 1000000) {
-            auto x = dis_x(gen);
-            auto y = dis_y(gen);
-
-            if (!v.contains(x, y) && image.contains(x, y) && image.at(x, y) != 0) {
-                retry = false;
-                v.add(x, y);                
-            }
-            n++;
+        auto site = sites.draw(dis.next());
+        if (!site) {
+            break;
         }
+        v.add(site->first, site->second);
     }
-    auto result = v.generate(image.width(), image.height());
-
-    result.for_each_pixel([&](auto& p, auto x, auto y) {
-        if (image.at(x, y) == 0) {
-            p = 0;
-        }
+    return v.generate(image.width(), image.height(), [&](auto x, auto y) {
+        return image.at(x, y) != 0;
     });
-
-    return result;
 }
 
-image<float> mask_to_border_regions(const image<float>& image, const int regions) {
+template<typename T>
+voronoi_diagram mask_to_border_regions(const image<T>& image, const int regions, const random_stream& stream) {
     voronoi_generator v;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis_x(0, image.width());
-    std::uniform_int_distribution<int> dis_y(0, image.height());
+    random_generator rnd(stream);
+    auto dis = rnd.uniform<double>(0.0, 1.0);
 
+    pixel_sampler sites(image.width(), image.height(), [&](auto x, auto y) {
+        return image.at(x, y) == 0;
+    });
     for (int i = 0; i < regions; i++) {
-        bool retry = true;
-        int n = 0;
-
-        while (retry && n < 1000000) {
-            auto x = dis_x(gen);
-            auto y = dis_y(gen);
-
-            if (!v.contains(x, y) && image.contains(x, y) && image.at(x, y) == 0) {
-                retry = false;
-                v.add(x, y);                
-            }
-            n++;
+        auto site = sites.draw(dis.next());
+        if (!site) {
+            break;
         }
+        v.add(site->first, site->second);
     }
-    auto result = v.generate(image.width(), image.height());
-
-    result.for_each_pixel([&](auto& p, auto x, auto y) {
-        if (image.at(x, y) == 0) {
-            p = 0;
-        }
+    return v.generate(image.width(), image.height(), [&](auto x, auto y) {
+        return image.at(x, y) != 0;
     });
-
-    return result;
 }
 
-int random_integer(const int min, const int max) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+template voronoi_diagram mask_to_regions(const image<float>& image, const int regions, const random_stream& stream);
+template voronoi_diagram mask_to_regions(const image<uint8_t>& image, const int regions, const random_stream& stream);
+template voronoi_diagram mask_to_border_regions(const image<float>& image, const int regions, const random_stream& stream);
+template voronoi_diagram mask_to_border_regions(const image<uint8_t>& image, const int regions, const random_stream& stream);
+
+int random_integer(random_stream& stream, const int min, const int max) {
     std::uniform_int_distribution<int> dis(min, max);
-    return dis(gen);
+    return dis(stream);
 }
 
-float random_float(const float min, const float bound) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(min, bound);
-    return dis(gen);
+float random_float(random_stream& stream, const float min, const float bound) {
+    return uniform_float(stream(), min, bound);
 }
 
 void quantify_image_pre_zero(image<float>& image, const int levels) {
@@ -320,9 +616,7 @@ std::pair<image<float>, image<float>> generate_river_level_and_height(const imag
 }
 
 void invert_image(image<float>& img) {
-    img.for_each_pixel([](auto& p) {
-        p = 1.0f - p;
-    });
+    img.shift_and_scale(execution::par, -1.0f, -1.0f);
 }
 
 image<float> resize_and_center(const image<float>& img, const size_t width, const size_t height) {
@@ -343,10 +637,7 @@ image<float> resize_and_center(const image<float>& img, const size_t width, cons
     return result;
 }
 
-void draw_random_manhattan_line(image<float>& img, const int start_x, const int start_y, const int end_x, const int end_y, const float color) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(0, 1.0);
+void draw_random_manhattan_line(image<float>& img, const int start_x, const int start_y, const int end_x, const int end_y, const float color, random_stream& stream) {
 
     int x = start_x;
     int y = start_y;
@@ -382,7 +673,7 @@ void draw_random_manhattan_line(image<float>& img, const int start_x, const int
             const float error_if_horizontal = std::abs(slope - (static_cast<float>(std::abs(y - start_y)) / static_cast<float>(std::abs(x + sx - start_x))));
             const float error_if_vertical = std::abs(slope - (static_cast<float>(std::abs(y + sy - start_y)) / static_cast<float>(std::abs(x - start_x))));
 
-            auto dice = dis(gen);
+            auto dice = random_float(stream, 0.0f, 1.0f);
             if (dice < 0.3) {
                 x += sx;
             } else if (dice < 0.6) {
@@ -431,38 +722,205 @@ void fade_borders(image<float>& map, const int range) {
     }    
 }
 
-image<int> generate_ocean_distance_map(const image<float>& mask) {
-    image<int> result(mask.width(), mask.height());
+namespace {
 
-    std::queue<std::pair<int, int>> remaining;
+// row-major distance buffer that is 0 where mask is 0 and far everywhere else
+template<typename D, typename T, typename layout_T>
+image<D> distance_seeds(const image<T, layout_T>& mask, const D far) {
+    auto seeds = mask.template convert<D>([far](const T& p) {
+        return p == 0 ? D(0) : far;
+    });
 
-    mask.for_each_pixel([&](auto p, int x, int y) {
-        if (p == 0) {
-            result.at(x, y) = 0;
-            remaining.push({x, y});
-        } else {
-            result.at(x, y) = mask.width() * mask.height();
+    if constexpr (std::is_same_v<layout_T, row_major_layout>) {
+        return seeds;
+    } else {
+        return seeds.template to_layout<row_major_layout>();
+    }
+}
+
+// d[x] = min(d[x'] + |x - x'|) in a forward and a backward sweep
+template<typename D>
+void sweep_row(D* d, const size_t n) {
+    for (size_t x = 1; x < n; x++) {
+        d[x] = std::min(d[x], d[x - 1] + 1);
+    }
+    for (size_t x = n - 1; x > 0; x--) {
+        d[x - 1] = std::min(d[x - 1], d[x] + 1);
+    }
+}
+
+// the same along the columns [x_begin, x_end), sweeping whole row segments to stay in cache
+template<typename D>
+void sweep_columns(image<D>& d, const size_t x_begin, const size_t x_end) {
+    auto n = x_end - x_begin;
+
+    for (size_t y = 1; y < d.height(); y++) {
+        D* row = d.pointer(x_begin, y);
+        const D* above = std::as_const(d).pointer(x_begin, y - 1);
+        for (size_t x = 0; x < n; x++) {
+            row[x] = std::min(row[x], above[x] + 1);
+        }
+    }
+    for (size_t y = d.height() - 1; y > 0; y--) {
+        D* row = d.pointer(x_begin, y - 1);
+        const D* below = std::as_const(d).pointer(x_begin, y);
+        for (size_t x = 0; x < n; x++) {
+            row[x] = std::min(row[x], below[x] + 1);
         }
+    }
+}
+
+// manhattan distances are separable: rows first, then columns, both in parallel bands
+template<typename D>
+void manhattan_distances(image<D>& d) {
+    d.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+        for (size_t y = begin; y < end; y++) {
+            sweep_row(d.row(y).data(), d.width());
+        }
+    });
+    thread_pool::shared().for_each_band(d.width(), [&](auto band, auto begin, auto end) {
+        sweep_columns(d, begin, end);
     });
+}
+
+// replaces the column distances g of a row by sqrt(min((x - q)^2 + g[q]^2)), the lower envelope
+// of parabolas from Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled Functions"
+void euclidean_row(float* d, const size_t n, std::vector<double>& f, std::vector<int>& v, std::vector<double>& z) {
+    f.resize(n);
+    v.resize(n);
+    z.resize(n + 1);
+    for (size_t q = 0; q < n; q++) {
+        f[q] = static_cast<double>(d[q]) * d[q];
+    }
 
-    auto check_pos = [&](const auto current, const auto x, const auto y) {
-        if (auto p = result.get(x, y)) {
-            if (current + 1 < **p) {
-                **p = current + 1;
-                remaining.push({x, y});
+    auto intersection = [&](const int q, const int p) {
+        return ((f[q] + double(q) * q) - (f[p] + double(p) * p)) / (2.0 * (q - p));
+    };
+
+    int length = n;
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<double>::infinity();
+    z[1] = std::numeric_limits<double>::infinity();
+    for (int q = 1; q < length; q++) {
+        auto s = intersection(q, v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = intersection(q, v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = std::numeric_limits<double>::infinity();
+    }
+
+    k = 0;
+    for (int x = 0; x < length; x++) {
+        while (z[k + 1] < x) {
+            k++;
+        }
+        double dx = x - v[k];
+        d[x] = std::sqrt(dx * dx + f[v[k]]);
+    }
+}
+
+// two raster scans with steps of 1 and sqrt(2), every row depends on the previous one, so this
+// one runs sequentially
+void chamfer_distances(image<float>& d) {
+    const float diagonal = std::sqrt(2.0f);
+    int width = d.width();
+    int height = d.height();
+
+    for (int y = 0; y < height; y++) {
+        float* row = d.row(y).data();
+        if (y > 0) {
+            const float* above = std::as_const(d).row(y - 1).data();
+            for (int x = 0; x < width; x++) {
+                row[x] = std::min(row[x], above[x] + 1);
+                if (x > 0) {
+                    row[x] = std::min(row[x], above[x - 1] + diagonal);
+                }
+                if (x + 1 < width) {
+                    row[x] = std::min(row[x], above[x + 1] + diagonal);
+                }
             }
         }
-    };
+        for (int x = 1; x < width; x++) {
+            row[x] = std::min(row[x], row[x - 1] + 1);
+        }
+    }
+    for (int y = height - 1; y >= 0; y--) {
+        float* row = d.row(y).data();
+        if (y + 1 < height) {
+            const float* below = std::as_const(d).row(y + 1).data();
+            for (int x = 0; x < width; x++) {
+                row[x] = std::min(row[x], below[x] + 1);
+                if (x > 0) {
+                    row[x] = std::min(row[x], below[x - 1] + diagonal);
+                }
+                if (x + 1 < width) {
+                    row[x] = std::min(row[x], below[x + 1] + diagonal);
+                }
+            }
+        }
+        for (int x = width - 1; x > 0; x--) {
+            row[x - 1] = std::min(row[x - 1], row[x] + 1);
+        }
+    }
+}
+
+}
+
+template<typename T, typename layout_T>
+image<float> distance_transform(const image<T, layout_T>& mask, const distance_metric metric) {
+    auto d = distance_seeds(mask, static_cast<float>(mask.width() * mask.height()));
+    if (d.width() == 0 || d.height() == 0) {
+        return d;
+    }
 
-    while (!remaining.empty()) {
-        auto [x, y] = remaining.front();
-        auto current = result.at(x, y);
-        check_pos(current, x + 1, y);
-        check_pos(current, x - 1, y);
-        check_pos(current, x, y + 1);
-        check_pos(current, x, y - 1);
-        remaining.pop();
+    switch (metric) {
+        case distance_metric::manhattan:
+            manhattan_distances(d);
+            break;
+        case distance_metric::chamfer:
+            chamfer_distances(d);
+            break;
+        case distance_metric::euclidean:
+            thread_pool::shared().for_each_band(d.width(), [&](auto band, auto begin, auto end) {
+                sweep_columns(d, begin, end);
+            });
+            d.for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+                std::vector<double> f;
+                std::vector<int> v;
+                std::vector<double> z;
+                for (size_t y = begin; y < end; y++) {
+                    euclidean_row(d.row(y).data(), d.width(), f, v, z);
+                }
+            });
+            break;
     }
 
-    return result; 
+    return d;
 }
+
+template image<float> distance_transform(const image<float, row_major_layout>& mask, const distance_metric metric);
+template image<float> distance_transform(const image<float, tiled_layout<>>& mask, const distance_metric metric);
+template image<float> distance_transform(const image<uint8_t, row_major_layout>& mask, const distance_metric metric);
+
+template<typename T, typename layout_T>
+image<int, layout_T> generate_ocean_distance_map(const image<T, layout_T>& mask) {
+    auto d = distance_seeds(mask, static_cast<int>(mask.width() * mask.height()));
+    if (d.width() > 0 && d.height() > 0) {
+        manhattan_distances(d);
+    }
+
+    if constexpr (std::is_same_v<layout_T, row_major_layout>) {
+        return d;
+    } else {
+        return d.template to_layout<layout_T>();
+    }
+}
+
+template image<int, row_major_layout> generate_ocean_distance_map(const image<float, row_major_layout>& mask);
+template image<int, tiled_layout<>> generate_ocean_distance_map(const image<float, tiled_layout<>>& mask);
+template image<int, row_major_layout> generate_ocean_distance_map(const image<uint8_t, row_major_layout>& mask);
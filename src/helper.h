@@ -4,31 +4,49 @@
 #include <vector>
 
 #include "image.h"
+#include "random_generator.h"
 #include "voronoi.h"
 
 float calc_distance(const int x, const int y, const int half_size, const int i, const int j);
 
-void add_gaussian_blur(image<float>& img);
-
+// 3x3 gaussian blur, the kernel is cut off and renormalized at the borders
+template<typename layout_T>
+void add_gaussian_blur(image<float, layout_T>& img);
+// same as calling add_gaussian_blur(img) iterations times, beyond 32 iterations an O(1) per pixel
+// approximation differs by less than 0.02 next to the border and 0.004 inside on images in [0, 1]
+template<typename layout_T>
+void add_gaussian_blur(image<float, layout_T>& img, const int iterations);
+
+// factor that maps [min, max] to [0, 1], 0 for an empty range, so a flat image becomes 0
+// instead of nan
+inline float range_factor(const float min, const float max) {
+    return max > min ? 1.0 / (max - min) : 0.0f;
+}
 void scale_range(image<float>& img);
 
 image<float> extract_non_zero_region(const image<float>& img);
 
 image<float> extract_background(const image<float>& img, const float threshold);
 
-std::vector<int> generate_grayscale_histogram(const image<float>& img);
+// 256 bins over [0, 1], p falls into the bin p * 255, values outside of [0, 1] are skipped
+std::vector<size_t> generate_grayscale_histogram(const image<float>& img);
 
 void apply_relative_threshold(image<float>& img, const float factor);
 
 void apply_circular_fade_out(image<float>& img, const float factor);
 
-void apply_relative_noise(image<float>& img, const float factor);
+void apply_relative_noise(image<float>& img, const float factor, const random_stream& stream);
 
-image<float> mask_to_regions(const image<float>& image, const int regions);
-image<float> mask_to_border_regions(const image<float>& image, const int regions);
+// voronoi regions over the non zero pixels of image, the sites of mask_to_regions lie on them, the
+// sites of mask_to_border_regions on the zero pixels around them
+template<typename T>
+voronoi_diagram mask_to_regions(const image<T>& image, const int regions, const random_stream& stream);
+template<typename T>
+voronoi_diagram mask_to_border_regions(const image<T>& image, const int regions, const random_stream& stream);
 
-int random_integer(const int min, const int max);
-float random_float(const float min, const float bound);
+// both draw the next number of stream
+int random_integer(random_stream& stream, const int min, const int max);
+float random_float(random_stream& stream, const float min, const float bound);
 
 void quantify_image_pre_zero(image<float>& image, const int levels);
 
@@ -39,8 +57,23 @@ void invert_image(image<float>& img);
 
 image<float> resize_and_center(const image<float>& img, const size_t width, const size_t height);
 
-void draw_random_manhattan_line(image<float>& img, const int start_x, const int start_y, const int end_x, const int end_y, const float color);
+void draw_random_manhattan_line(image<float>& img, const int start_x, const int start_y, const int end_x, const int end_y, const float color, random_stream& stream);
 
 void fade_borders(image<float>& map, const int range);
 
-image<int> generate_ocean_distance_map(const image<float>& mask);
+enum class distance_metric {
+    // 4-connected steps, exact
+    manhattan,
+    // 8-connected steps of 1 and sqrt(2), overestimates euclidean distances by about 8 percent at most
+    chamfer,
+    // exact
+    euclidean
+};
+
+// distance of every pixel to the nearest pixel where mask is 0, width * height if there is none
+template<typename T, typename layout_T>
+image<float> distance_transform(const image<T, layout_T>& mask, const distance_metric metric);
+
+// manhattan distance to the nearest pixel where mask is 0
+template<typename T, typename layout_T>
+image<int, layout_T> generate_ocean_distance_map(const image<T, layout_T>& mask);
@@ -5,54 +5,117 @@
 #include <functional>
 #include <optional>
 #include <limits>
+#include <utility>
+#include <tuple>
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include "execution.h"
+#include "image_layout.h"
+#include "image_storage.h"
+#include "simd.h"
+#include "thread_pool.h"
 
 template<typename caller_T, typename... Ts>
 concept caller_accepts_arguments = requires(caller_T caller, Ts... s) {
     caller(s...);
 };
 
-template<typename T>
+template<typename T, typename layout_T = row_major_layout>
 class image {
 public:
-    image(const size_t width, const size_t height) : m_width(width), m_height(height), m_offset(0), m_row_stride(width), m_data(std::make_shared<std::vector<T>>(width * height)) {
+    using layout_type = layout_T;
+
+    constexpr static const bool contiguous_rows = requires(const layout_T& layout) { layout.offset(0, 0); };
+
+    image(const size_t width, const size_t height) : m_width(width), m_height(height), m_layout(width, height), m_data(std::make_shared<image_storage<T>>(m_layout.storage_size())) {
             m_direct_data = m_data->data();
         }
-    image(const size_t width, const size_t height, const T p) : m_width(width), m_height(height), m_offset(0), m_row_stride(width), m_data(std::make_shared<std::vector<T>>(width * height)) {
+    image(const size_t width, const size_t height, const T p) : m_width(width), m_height(height), m_layout(width, height), m_data(std::make_shared<image_storage<T>>(m_layout.storage_size(), image_backing::automatic, image_init::uninitialized)) {
+        m_direct_data = m_data->data();
+        for_each_pixel([p](T& f) {
+            f = p;
+        });
+    }
+    // with image_init::uninitialized the pixels are left unset and have to be overwritten by the caller
+    image(const size_t width, const size_t height, const image_init init) : m_width(width), m_height(height), m_layout(width, height), m_data(std::make_shared<image_storage<T>>(m_layout.storage_size(), image_backing::automatic, init)) {
+        m_direct_data = m_data->data();
+    }
+    // backing selects where the pixels are stored, see image_memory
+    image(const size_t width, const size_t height, const image_backing backing) : m_width(width), m_height(height), m_layout(width, height), m_data(std::make_shared<image_storage<T>>(m_layout.storage_size(), backing)) {
+        m_direct_data = m_data->data();
+    }
+    // surrounds the image with halo_size pixels set to sentinel on every side, they are not part
+    // of the image (contains() is false) but at() and neighbor_offset() can read them, so
+    // stencils at the border need no bounds checks
+    image(const size_t width, const size_t height, const T p, const size_t halo_size, const T sentinel) : m_width(width), m_height(height), m_layout(width, height, halo_size), m_data(std::make_shared<image_storage<T>>(m_layout.storage_size(), image_backing::automatic, image_init::uninitialized)) {
         m_direct_data = m_data->data();
+        std::fill_n(m_data->data(), m_data->size(), sentinel);
         for_each_pixel([p](T& f) {
             f = p;
         });
     }
+    // copies share the pixel buffer until one of them is accessed mutably (copy-on-write),
+    // use copy() to get an independent buffer right away
+    // a buffer that views write to is copied right away, as writes through the views would
+    // otherwise show up in the copy
     image(const image& copy) : 
         m_width(copy.m_width),
         m_height(copy.m_height),
-        m_offset(copy.m_offset),
-        m_row_stride(copy.m_row_stride),
-        m_data(std::make_shared<std::vector<T>>(*(copy).m_data)) {
-                m_direct_data = m_data->data();
+        m_layout(copy.m_layout),
+        m_data(copy.m_data),
+        m_direct_data(copy.m_direct_data) {
+            if (m_data) {
+                m_data->owners++;
+                if (m_data->views.load(std::memory_order_acquire) > 0) {
+                    detach();
+                }
             }
-    image(image&& move) : m_width(move.m_width), m_height(move.m_height), m_offset(move.m_offset), m_row_stride(move.m_row_stride), m_data(std::move(move.m_data)) {
-        m_direct_data = m_data->data();
+        }
+    // a moved-from image has no storage, it can only be assigned to, copied or destroyed
+    image(image&& move) : m_width(move.m_width), m_height(move.m_height), m_layout(move.m_layout), m_data(std::move(move.m_data)), m_view(move.m_view) {
+        m_direct_data = m_data ? m_data->data() : nullptr;
         move.m_width = 0;
         move.m_height = 0;
+        move.m_direct_data = nullptr;
+    }
+    ~image() {
+        release();
     }
     void operator=(const image& copy) {
+        if (this == &copy) {
+            return;
+        }
+        release();
         m_width = copy.m_width;
         m_height = copy.m_height;
-        m_offset = copy.m_offset;
-        m_row_stride = copy.m_row_stride;
-        m_data = std::make_shared<std::vector<T>>(*(copy.m_data));
-        m_direct_data = m_data->data();
+        m_layout = copy.m_layout;
+        m_data = copy.m_data;
+        m_direct_data = copy.m_direct_data;
+        m_view = false;
+        if (m_data) {
+            m_data->owners++;
+            if (m_data->views.load(std::memory_order_acquire) > 0) {
+                detach();
+            }
+        }
     }
     void operator=(image&& move) {
+        if (this == &move) {
+            return;
+        }
+        release();
         m_width = move.m_width;
         m_height = move.m_height;
-        m_offset = move.m_offset;
-        m_row_stride = move.m_row_stride;
+        m_layout = move.m_layout;
         m_data = std::move(move.m_data);
-        m_direct_data = m_data->data();
+        m_direct_data = m_data ? m_data->data() : nullptr;
+        m_view = move.m_view;
         move.m_width = 0;
         move.m_height = 0;
+        move.m_direct_data = nullptr;
     }
     size_t width() const {
         return m_width;
@@ -63,6 +126,16 @@ public:
     size_t size() const {
         return width() * height();
     }
+    size_t halo() const {
+        return m_layout.halo();
+    }
+    bool is_mapped() const {
+        return m_data->mapped();
+    }
+    // access pattern hint for memory-mapped images, ignored for heap images
+    void advise(const image_access access) {
+        m_data->advise(access);
+    }
     bool contains(const int x, const int y) const {
         return 0 <= x && x < m_width && 0 <= y && y < m_height;
     }
@@ -82,153 +155,470 @@ public:
         return std::nullopt;
     }
     const T& at(const int x, const int y) const {
-        size_t ptr = m_offset + y * m_row_stride + x;
-        return m_direct_data[ptr];
+        return m_direct_data[m_layout.index(x, y)];
     }
     T& at(const int x, const int y) {
-        size_t ptr = m_offset + y * m_row_stride + x;
-        return m_direct_data[ptr];
+        ensure_unique();
+        return pixel(x, y);
     }
     T* data() {
-        return m_data->data();
+        ensure_unique();
+        return m_direct_data;
+    }
+    // rows are contiguous in memory for row-major layouts
+    std::span<T> row(const size_t y) requires contiguous_rows {
+        ensure_unique();
+        return {&pixel(0, y), m_width};
+    }
+    std::span<const T> row(const size_t y) const requires contiguous_rows {
+        return {&pixel(0, y), m_width};
+    }
+    // unchecked access for stencils: pointer(x, y)[neighbor_offset(dx, dy)] is the pixel at
+    // (x + dx, y + dy), which has to lie inside the image or its halo
+    T* pointer(const int x, const int y) {
+        ensure_unique();
+        return &pixel(x, y);
+    }
+    const T* pointer(const int x, const int y) const {
+        return &pixel(x, y);
+    }
+    std::ptrdiff_t neighbor_offset(const int dx, const int dy) const
+        requires contiguous_rows {
+        return m_layout.offset(dx, dy);
     }
     template<typename exec_T>
         requires caller_accepts_arguments<exec_T, T>
     void for_each_pixel(const exec_T& call) {
-        for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                call(at(x, y));
-            }
-        }
+        for_each_pixel(execution::seq, call);
     }
     template<typename exec_T>
         requires caller_accepts_arguments<exec_T, T>
     void for_each_pixel(const exec_T& call) const {
-        for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                call(at(x, y));
-            }
-        }
+        for_each_pixel(execution::seq, call);
     }
     template<typename exec_T>
         requires caller_accepts_arguments<exec_T, T>
     void check_each_pixel(const exec_T& call) {
-        for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                if (!call(at(x, y))) {
-                    return;
-                }
-            }
-        }
+        check_each_pixel(execution::seq, call);
     }
     template<typename exec_T>
         requires caller_accepts_arguments<exec_T, T>
     void check_each_pixel(const exec_T& call) const {
-        for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                if (!call(at(x, y))) {
-                    return;
-                }
-            }
-        }
+        check_each_pixel(execution::seq, call);
     }
     template<typename exec_T>
         requires caller_accepts_arguments<exec_T, T, size_t, size_t>
     void for_each_pixel(const exec_T& call) {
-        for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                call(at(x, y), x, y);
-            }
-        }
+        for_each_pixel(execution::seq, call);
     }
     template<typename exec_T>
         requires caller_accepts_arguments<exec_T, T, size_t, size_t>
     void for_each_pixel(const exec_T& call) const {
-        for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                call(at(x, y), x, y);
+        for_each_pixel(execution::seq, call);
+    }
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, T>
+    void for_each_pixel(const policy_T& policy, const exec_T& call) {
+        ensure_unique();
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                for_each_column(policy, [&](const size_t x) {
+                    call(pixel(x, y));
+                });
+            }
+        });
+    }
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, T>
+    void for_each_pixel(const policy_T& policy, const exec_T& call) const {
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                for_each_column(policy, [&](const size_t x) {
+                    call(pixel(x, y));
+                });
+            }
+        });
+    }
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, T, size_t, size_t>
+    void for_each_pixel(const policy_T& policy, const exec_T& call) {
+        ensure_unique();
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                for_each_column(policy, [&](const size_t x) {
+                    call(pixel(x, y), x, y);
+                });
+            }
+        });
+    }
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, T, size_t, size_t>
+    void for_each_pixel(const policy_T& policy, const exec_T& call) const {
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                for_each_column(policy, [&](const size_t x) {
+                    call(pixel(x, y), x, y);
+                });
+            }
+        });
+    }
+    // with a parallel policy every band stops at its first rejected pixel and the
+    // remaining bands stop at their next row
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, T>
+    void check_each_pixel(const policy_T& policy, const exec_T& call) {
+        ensure_unique();
+        std::atomic<bool> stop = false;
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end && !stop; y++) {
+                for (size_t x = 0; x < m_width; x++) {
+                    if (!call(pixel(x, y))) {
+                        stop = true;
+                        return;
+                    }
+                }
+            }
+        });
+    }
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, T>
+    void check_each_pixel(const policy_T& policy, const exec_T& call) const {
+        std::atomic<bool> stop = false;
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end && !stop; y++) {
+                for (size_t x = 0; x < m_width; x++) {
+                    if (!call(pixel(x, y))) {
+                        stop = true;
+                        return;
+                    }
+                }
             }
+        });
+    }
+    // calls call(band, begin_row, end_row) once per row band, bands run concurrently with a parallel policy
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, size_t, size_t, size_t>
+    void for_each_row_band(const policy_T& policy, const exec_T& call) const {
+        if constexpr (execution::parallel<policy_T>) {
+            thread_pool::shared().for_each_band(m_height, call);
+        } else {
+            call(0, 0, m_height);
         }
     }
-    std::optional<image> subregion(const int x, const int y, const int width, const int height) const {
-        if (contains(x, y, width, height)) {
-            image result;
-            result.m_width = width;
-            result.m_height = height;
-            result.m_offset = m_offset + y * m_row_stride + x;
-            result.m_row_stride = m_row_stride;
-            result.m_data = m_data;
-            result.m_direct_data = (result.m_data->data());
-
-            return result;
+    // calls call(x_begin, y_begin, x_end, y_end) for every tile of the storage layout, the tiles
+    // are aligned to the storage blocks, rows of tiles run concurrently with a parallel policy
+    template<typename exec_T>
+        requires caller_accepts_arguments<exec_T, size_t, size_t, size_t, size_t>
+    void for_each_tile(const exec_T& call) const {
+        for_each_tile(execution::seq, call);
+    }
+    template<execution::policy policy_T, typename exec_T>
+        requires caller_accepts_arguments<exec_T, size_t, size_t, size_t, size_t>
+    void for_each_tile(const policy_T& policy, const exec_T& call) const {
+        auto tile_begin = [](const size_t length, const size_t tile_length, const size_t phase, const size_t n) -> size_t {
+            if (n == 0) {
+                return 0;
+            }
+            return std::min(length, (tile_length - phase) + (n - 1) * tile_length);
+        };
+        auto tile_count = [](const size_t length, const size_t tile_length, const size_t phase) -> size_t {
+            if (length <= tile_length - phase) {
+                return length > 0;
+            }
+            return 1 + (length - (tile_length - phase) + tile_length - 1) / tile_length;
+        };
+
+        auto rows = tile_count(m_height, layout_T::tile_height, m_layout.tile_phase_y());
+        auto columns = tile_count(m_width, layout_T::tile_width, m_layout.tile_phase_x());
+
+        auto process_rows = [&](auto band, auto begin, auto end) {
+            for (size_t row = begin; row < end; row++) {
+                auto y_begin = tile_begin(m_height, layout_T::tile_height, m_layout.tile_phase_y(), row);
+                auto y_end = tile_begin(m_height, layout_T::tile_height, m_layout.tile_phase_y(), row + 1);
+                for (size_t column = 0; column < columns; column++) {
+                    auto x_begin = tile_begin(m_width, layout_T::tile_width, m_layout.tile_phase_x(), column);
+                    auto x_end = tile_begin(m_width, layout_T::tile_width, m_layout.tile_phase_x(), column + 1);
+                    call(x_begin, y_begin, x_end, y_end);
+                }
+            }
+        };
+
+        if constexpr (execution::parallel<policy_T>) {
+            thread_pool::shared().for_each_band(rows, process_rows);
+        } else {
+            process_rows(0, 0, rows);
+        }
+    }
+    template<execution::policy policy_T>
+    size_t row_bands(const policy_T& policy) const {
+        if constexpr (execution::parallel<policy_T>) {
+            return thread_pool::shared().bands(m_height);
+        } else {
+            return 1;
+        }
+    }
+    // the returned image is a view on this image, writes to it are visible here and writes here
+    // are visible in it, copies of either of them get their own pixels
+    std::optional<image> subregion(const int x, const int y, const int width, const int height) {
+        ensure_unique();
+        auto result = make_subregion(x, y, width, height);
+        if (result) {
+            result->m_view = true;
+            m_data->views++;
         }
 
-        return std::nullopt;
+        return result;
     }
-    void copy_to(image& dest) const {
-        for (size_t y = 0; y < std::min(m_height, dest.m_height); y++) {
-            for (size_t x = 0; x < std::min(m_width, dest.m_width); x++) {
-                dest.at(x, y) = this->at(x, y);
+    // a subregion of a const image shares the pixels like a copy, it gets its own pixels when
+    // it is written to
+    std::optional<image> subregion(const int x, const int y, const int width, const int height) const {
+        auto result = make_subregion(x, y, width, height);
+        if (result) {
+            m_data->owners++;
+            if (m_data->views.load(std::memory_order_acquire) > 0) {
+                result->detach();
             }
         }
+
+        return result;
+    }
+    template<typename other_layout_T>
+    void copy_to(image<T, other_layout_T>& dest) const {
+        copy_to(execution::seq, dest);
+    }
+    template<execution::policy policy_T, typename other_layout_T>
+    void copy_to(const policy_T& policy, image<T, other_layout_T>& dest) const {
+        auto width = std::min(m_width, dest.m_width);
+        auto height = std::min(m_height, dest.m_height);
+        dest.ensure_unique();
+
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < std::min<size_t>(end, height); y++) {
+                if constexpr (contiguous_rows && image<T, other_layout_T>::contiguous_rows) {
+                    std::copy_n(&this->pixel(0, y), width, &dest.pixel(0, y));
+                } else {
+                    for_each_column(policy, width, [&](const size_t x) {
+                        dest.pixel(x, y) = this->pixel(x, y);
+                    });
+                }
+            }
+        });
     }
     image copy() const {
-        image result(width(), height());
+        image result;
+        result.m_width = m_width;
+        result.m_height = m_height;
+        std::tie(result.m_layout, result.m_data) = copy_storage();
+        result.m_direct_data = result.m_data->data();
 
-        copy_to(result);
+        return result;
+    }
+    template<typename other_layout_T>
+    image<T, other_layout_T> to_layout() const {
+        image<T, other_layout_T> result(width(), height(), image_init::uninitialized);
+
+        copy_to(execution::par, result);
 
         return result;
     }
-    void add(const image& src) {
-        for (size_t y = 0; y < std::min(m_height, src.m_height); y++) {
-            for (size_t x = 0; x < std::min(m_width, src.m_width); x++) {
-                this->at(x, y) += src.at(x, y);
+    // converts the pixels to another type, e.g. to keep masks as uint8_t or heights as half
+    template<typename U>
+    image<U, layout_T> convert() const {
+        return convert<U>([](const T& p) {
+            return static_cast<U>(p);
+        });
+    }
+    template<typename U, typename F>
+    image<U, layout_T> convert(F f) const {
+        image<U, layout_T> result(width(), height(), image_init::uninitialized);
+
+        for_each_row_band(execution::par, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                for (size_t x = 0; x < m_width; x++) {
+                    result.pixel(x, y) = f(pixel(x, y));
+                }
             }
-        }
+        });
+
+        return result;
     }
-    void mix_max(const image& src) {
-        for (size_t y = 0; y < std::min(m_height, src.m_height); y++) {
-            for (size_t x = 0; x < std::min(m_width, src.m_width); x++) {
-                this->at(x, y) = std::max(this->at(x, y), src.at(x, y));
+    // evaluates a pixel expression (see image_expression.h) into this image in a single sweep,
+    // the expression may read this image itself
+    template<execution::policy policy_T, typename expression_T>
+    void assign(const policy_T& policy, const expression_T& e) {
+        ensure_unique();
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                for_each_column(policy, [&](const size_t x) {
+                    pixel(x, y) = e(x, y);
+                });
             }
+        });
+    }
+    // same as assign(policy, e), but also folds the assigned pixels with reducer and returns the result
+    template<execution::policy policy_T, typename expression_T, typename reducer_T>
+    typename reducer_T::value_type assign(const policy_T& policy, const expression_T& e, const reducer_T& reducer) {
+        ensure_unique();
+        std::vector<typename reducer_T::value_type> partials(row_bands(policy), reducer.identity());
+
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            auto result = partials[band];
+            for (size_t y = begin; y < end; y++) {
+                for (size_t x = 0; x < m_width; x++) {
+                    auto& p = pixel(x, y);
+                    p = e(x, y);
+                    reducer.accumulate(result, p);
+                }
+            }
+            partials[band] = result;
+        });
+
+        auto result = reducer.identity();
+        for (const auto& partial : partials) {
+            reducer.merge(result, partial);
         }
+
+        return result;
+    }
+    template<typename other_layout_T>
+    void add(const image<T, other_layout_T>& src) {
+        add(execution::seq, src);
+    }
+    template<execution::policy policy_T, typename other_layout_T>
+    void add(const policy_T& policy, const image<T, other_layout_T>& src) {
+        ensure_unique();
+        auto width = std::min(m_width, src.m_width);
+        auto height = std::min(m_height, src.m_height);
+
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < std::min<size_t>(end, height); y++) {
+                if constexpr (simd_rows<other_layout_T>) {
+                    simd::add(&this->pixel(0, y), &src.pixel(0, y), width);
+                } else {
+                    for_each_column(policy, width, [&](const size_t x) {
+                        this->pixel(x, y) += src.pixel(x, y);
+                    });
+                }
+            }
+        });
+    }
+    template<typename other_layout_T>
+    void mix_max(const image<T, other_layout_T>& src) {
+        mix_max(execution::seq, src);
+    }
+    template<execution::policy policy_T, typename other_layout_T>
+    void mix_max(const policy_T& policy, const image<T, other_layout_T>& src) {
+        ensure_unique();
+        auto width = std::min(m_width, src.m_width);
+        auto height = std::min(m_height, src.m_height);
+
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < std::min<size_t>(end, height); y++) {
+                if constexpr (simd_rows<other_layout_T>) {
+                    simd::max(&this->pixel(0, y), &src.pixel(0, y), width);
+                } else {
+                    for_each_column(policy, width, [&](const size_t x) {
+                        this->pixel(x, y) = std::max(this->pixel(x, y), src.pixel(x, y));
+                    });
+                }
+            }
+        });
     }
     std::pair<T, T> range() const {
+        return range(execution::seq);
+    }
+    template<execution::policy policy_T>
+    std::pair<T, T> range(const policy_T& policy) const {
+        std::vector<std::pair<T, T>> partials(row_bands(policy), {std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()});
+
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            auto [min, max] = partials[band];
+            for (size_t y = begin; y < end; y++) {
+                if constexpr (simd_rows<layout_T>) {
+                    simd::minmax(&pixel(0, y), m_width, min, max);
+                } else {
+                    for (size_t x = 0; x < m_width; x++) {
+                        min = std::min(min, pixel(x, y));
+                        max = std::max(max, pixel(x, y));
+                    }
+                }
+            }
+            partials[band] = {min, max};
+        });
+
         T min = std::numeric_limits<T>::max();
         T max = std::numeric_limits<T>::lowest();
 
-        for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                min = std::min(min, at(x, y));
-                max = std::max(max, at(x, y));
-            }
+        for (const auto& [partial_min, partial_max] : partials) {
+            min = std::min(min, partial_min);
+            max = std::max(max, partial_max);
         }
        
         return {min, max};
     }
+    // replaces every pixel <= v by s
     void apply_lower_threshold(const T& v, const T& s) {
-        for_each_pixel([v, s](float& f) {
-            if (f <= v) {
-                f = s;
+        apply_lower_threshold(execution::seq, v, s);
+    }
+    template<execution::policy policy_T>
+    void apply_lower_threshold(const policy_T& policy, const T& v, const T& s) {
+        apply_lower_threshold(policy, v, s, true);
+    }
+    // replaces every pixel < v by s
+    void apply_strict_lower_threshold(const T& v, const T& s) {
+        apply_strict_lower_threshold(execution::seq, v, s);
+    }
+    template<execution::policy policy_T>
+    void apply_strict_lower_threshold(const policy_T& policy, const T& v, const T& s) {
+        apply_lower_threshold(policy, v, s, false);
+    }
+    // p = (p + offset) * factor
+    void shift_and_scale(const T& offset, const T& factor) {
+        shift_and_scale(execution::seq, offset, factor);
+    }
+    template<execution::policy policy_T>
+    void shift_and_scale(const policy_T& policy, const T& offset, const T& factor) {
+        ensure_unique();
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                if constexpr (simd_rows<layout_T>) {
+                    simd::shift_and_scale(&pixel(0, y), m_width, offset, factor);
+                } else {
+                    for_each_column(policy, [&](const size_t x) {
+                        pixel(x, y) = (pixel(x, y) + offset) * factor;
+                    });
+                }
             }
         });
     }
     void mirror_vertical() {
+        ensure_unique();
         for (size_t y = 0; y < m_height; y++) {
-            for (size_t x = 0; x < m_width / 2; x++) {
-                std::swap(at(x, y), at(m_width - 1 - x, y));
+            if constexpr (simd_rows<layout_T>) {
+                simd::reverse(&pixel(0, y), m_width);
+            } else if constexpr (contiguous_rows) {
+                std::reverse(&pixel(0, y), &pixel(0, y) + m_width);
+            } else {
+                for (size_t x = 0; x < m_width / 2; x++) {
+                    std::swap(pixel(x, y), pixel(m_width - 1 - x, y));
+                }
             }
         }
     }
     void mirror_horizontal() {
+        ensure_unique();
         for (size_t y = 0; y < m_height / 2; y++) {
-            for (size_t x = 0; x < m_width; x++) {
-                std::swap(at(x, y), at(x, m_height - 1 - y));
+            if constexpr (contiguous_rows) {
+                std::swap_ranges(&pixel(0, y), &pixel(0, y) + m_width, &pixel(0, m_height - 1 - y));
+            } else {
+                for (size_t x = 0; x < m_width; x++) {
+                    std::swap(pixel(x, y), pixel(x, m_height - 1 - y));
+                }
             }
         }
     }
-    image<T> rescale(const size_t new_width, const size_t new_height) const {
-        image<T> result(new_width, new_height);
+    image rescale(const size_t new_width, const size_t new_height) const {
+        image result(new_width, new_height, image_init::uninitialized);
         
         result.for_each_pixel([&](auto& p, auto x, auto y) {
             auto scale_x = static_cast<float>(x) / new_width;
@@ -241,6 +631,7 @@ public:
             T bot;
             T botright;
 
+            p = T();
             if (this->contains(ref_x, ref_y)) {
                 p = this->at(ref_x, ref_y);
             }
@@ -309,16 +700,116 @@ public:
             }
         }
     }
-    image<T> copy_shape() const {
-        image<T> result(width(), height());
+    image copy_shape() const {
+        image result(width(), height());
         return result;
     }
 private:
+    template<typename, typename>
+    friend class image;
+
     image() {}
+
+    // float rows that can be handed to the simd kernels
+    template<typename other_layout_T>
+    constexpr static const bool simd_rows = std::is_same_v<T, float> && contiguous_rows && image<T, other_layout_T>::contiguous_rows;
+
+    template<execution::policy policy_T>
+    void apply_lower_threshold(const policy_T& policy, const T& v, const T& s, const bool inclusive) {
+        ensure_unique();
+        for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+            for (size_t y = begin; y < end; y++) {
+                if constexpr (simd_rows<layout_T>) {
+                    simd::lower_threshold(&pixel(0, y), m_width, v, s, inclusive);
+                } else {
+                    for_each_column(policy, [&](const size_t x) {
+                        auto& f = pixel(x, y);
+                        if (f < v || (inclusive && f == v)) {
+                            f = s;
+                        }
+                    });
+                }
+            }
+        });
+    }
+
+    const T& pixel(const int x, const int y) const {
+        return m_direct_data[m_layout.index(x, y)];
+    }
+    T& pixel(const int x, const int y) {
+        return m_direct_data[m_layout.index(x, y)];
+    }
+    void ensure_unique() {
+        if (!m_view && m_data->owners.load(std::memory_order_acquire) > 1) {
+            detach();
+        }
+    }
+    // copies the pixels including the halo into a new compact buffer
+    std::pair<layout_T, std::shared_ptr<image_storage<T>>> copy_storage() const {
+        layout_T layout(m_width, m_height, halo());
+        auto data = std::make_shared<image_storage<T>>(layout.storage_size(), image_backing::automatic, image_init::uninitialized);
+        int border = halo();
+
+        for (int y = -border; y < static_cast<int>(m_height) + border; y++) {
+            for (int x = -border; x < static_cast<int>(m_width) + border; x++) {
+                data->data()[layout.index(x, y)] = pixel(x, y);
+            }
+        }
+        image_copy_counter::add(layout.storage_size() * sizeof(T));
+
+        return {layout, std::move(data)};
+    }
+    void detach() {
+        auto [layout, data] = copy_storage();
+
+        release();
+        m_layout = layout;
+        m_data = std::move(data);
+        m_direct_data = m_data->data();
+    }
+    void release() {
+        if (m_data && m_view) {
+            m_data->views--;
+        } else if (m_data) {
+            m_data->owners--;
+        }
+    }
+    // neither an owner nor a view yet, the callers register it as one of them
+    std::optional<image> make_subregion(const int x, const int y, const int width, const int height) const {
+        if (!contains(x, y, width, height)) {
+            return std::nullopt;
+        }
+
+        image result;
+        result.m_width = width;
+        result.m_height = height;
+        result.m_layout = m_layout.subregion(x, y);
+        result.m_data = m_data;
+        result.m_direct_data = m_direct_data;
+
+        return result;
+    }
+    template<execution::policy policy_T, typename exec_T>
+    void for_each_column(const policy_T& policy, const exec_T& call) const {
+        for_each_column(policy, m_width, call);
+    }
+    template<execution::policy policy_T, typename exec_T>
+    static void for_each_column(const policy_T& policy, const size_t width, const exec_T& call) {
+        if constexpr (execution::unsequenced<policy_T>) {
+#pragma GCC ivdep
+            for (size_t x = 0; x < width; x++) {
+                call(x);
+            }
+        } else {
+            for (size_t x = 0; x < width; x++) {
+                call(x);
+            }
+        }
+    }
     size_t m_width;
     size_t m_height;
-    size_t m_offset;
-    size_t m_row_stride;
-    std::shared_ptr<std::vector<T>> m_data;
+    layout_T m_layout;
+    std::shared_ptr<image_storage<T>> m_data;
     T* m_direct_data;
+    bool m_view = false;
 };
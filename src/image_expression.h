@@ -0,0 +1,333 @@
+#pragma once
+
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <concepts>
+#include <algorithm>
+
+#include "execution.h"
+#include "image.h"
+#include "thread_pool.h"
+
+// lazy pointwise expressions over images: map and zip only record what to compute, the pixels are
+// evaluated when the expression is assigned (image::assign, evaluate) or reduced, so a chain of
+// pointwise operations costs one sweep over memory instead of one per operation
+// expressions hold references to the images they read, which have to outlive them
+namespace expression {
+
+template<typename T>
+concept node = requires(const T& n, const size_t x, const size_t y) {
+    typename T::value_type;
+    { n.width() } -> std::convertible_to<size_t>;
+    { n.height() } -> std::convertible_to<size_t>;
+    { n(x, y) } -> std::convertible_to<typename T::value_type>;
+};
+
+template<typename T, typename layout_T>
+class source {
+public:
+    using value_type = T;
+
+    explicit source(const image<T, layout_T>& img) : m_image(img) {}
+
+    size_t width() const {
+        return m_image.width();
+    }
+    size_t height() const {
+        return m_image.height();
+    }
+    const T& operator()(const size_t x, const size_t y) const {
+        return m_image.at(x, y);
+    }
+    const T* row(const size_t y) const requires image<T, layout_T>::contiguous_rows {
+        return m_image.row(y).data();
+    }
+private:
+    const image<T, layout_T>& m_image;
+};
+
+// applies f to the pixels of all nodes at the same position, all nodes have the size of the first
+template<typename F, node... nodes_T>
+class zip_node {
+public:
+    using value_type = std::decay_t<std::invoke_result_t<const F&, typename nodes_T::value_type...>>;
+
+    explicit zip_node(F f, nodes_T... nodes) : m_f(std::move(f)), m_nodes(std::move(nodes)...) {}
+
+    size_t width() const {
+        return std::get<0>(m_nodes).width();
+    }
+    size_t height() const {
+        return std::get<0>(m_nodes).height();
+    }
+    value_type operator()(const size_t x, const size_t y) const {
+        return std::apply([&](const auto&... nodes) {
+            return m_f(nodes(x, y)...);
+        }, m_nodes);
+    }
+private:
+    F m_f;
+    std::tuple<nodes_T...> m_nodes;
+};
+
+template<typename T, typename layout_T>
+source<T, layout_T> as_node(const image<T, layout_T>& img) {
+    return source<T, layout_T>(img);
+}
+template<node node_T>
+const node_T& as_node(const node_T& n) {
+    return n;
+}
+
+template<typename F, typename... sources_T>
+auto zip(F f, const sources_T&... sources) {
+    return zip_node<F, std::decay_t<decltype(as_node(sources))>...>(std::move(f), as_node(sources)...);
+}
+template<typename source_T, typename F>
+auto map(const source_T& src, F f) {
+    return zip(std::move(f), src);
+}
+
+// reducers fold pixel values, the partial results of parallel bands are merged in band order
+// a reducer may provide accumulate_row(result, row, n), which is used for whole rows of images
+template<typename T>
+struct minmax {
+    using value_type = std::pair<T, T>;
+
+    value_type identity() const {
+        return {std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+    }
+    void accumulate(value_type& result, const T& p) const {
+        result.first = std::min(result.first, p);
+        result.second = std::max(result.second, p);
+    }
+    void accumulate_row(value_type& result, const T* row, const size_t n) const {
+        if constexpr (std::is_same_v<T, float>) {
+            simd::minmax(row, n, result.first, result.second);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                accumulate(result, row[i]);
+            }
+        }
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        accumulate(result, partial.first);
+        accumulate(result, partial.second);
+    }
+};
+
+template<typename T>
+struct maximum {
+    using value_type = T;
+
+    T initial = std::numeric_limits<T>::lowest();
+
+    value_type identity() const {
+        return initial;
+    }
+    void accumulate(value_type& result, const T& p) const {
+        result = std::max(result, p);
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        accumulate(result, partial);
+    }
+};
+
+// sums in A, a double by default so the result barely depends on how the image is split into bands
+template<typename T, typename A = double>
+struct sum {
+    using value_type = A;
+
+    value_type identity() const {
+        return A();
+    }
+    void accumulate(value_type& result, const T& p) const {
+        result += p;
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        result += partial;
+    }
+};
+
+template<typename T>
+struct count {
+    using value_type = size_t;
+
+    value_type identity() const {
+        return 0;
+    }
+    void accumulate(value_type& result, const T&) const {
+        result++;
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        result += partial;
+    }
+};
+
+// counts the values in [low, high] in bins equally wide bins, high itself falls into the last bin,
+// values outside of the range are skipped
+template<typename T>
+struct histogram {
+    using value_type = std::vector<size_t>;
+
+    size_t bins;
+    T low;
+    T high;
+
+    value_type identity() const {
+        return value_type(bins, 0);
+    }
+    void accumulate(value_type& result, const T& p) const {
+        if (p < low || p > high) {
+            return;
+        }
+        auto bin = static_cast<size_t>((p - low) * (bins / (high - low)));
+        result[std::min(bin, bins - 1)]++;
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        for (size_t i = 0; i < bins; i++) {
+            result[i] += partial[i];
+        }
+    }
+};
+
+// reduces the values of (label, value) pairs per label with reducer, indexed by the label,
+// negative labels are skipped and the result grows up to the largest label
+template<typename L, typename reducer_T>
+struct by_label {
+    using value_type = std::vector<typename reducer_T::value_type>;
+
+    reducer_T reducer = {};
+
+    value_type identity() const {
+        return {};
+    }
+    template<typename V>
+    void accumulate(value_type& result, const std::pair<L, V>& p) const {
+        if constexpr (std::is_signed_v<L>) {
+            if (p.first < 0) {
+                return;
+            }
+        }
+        auto label = static_cast<size_t>(p.first);
+        if (label >= result.size()) {
+            result.resize(label + 1, reducer.identity());
+        }
+        reducer.accumulate(result[label], p.second);
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        if (partial.size() > result.size()) {
+            result.resize(partial.size(), reducer.identity());
+        }
+        for (size_t i = 0; i < partial.size(); i++) {
+            reducer.merge(result[i], partial[i]);
+        }
+    }
+};
+
+// pixels per label, indexed by the label
+template<typename L>
+struct label_counts {
+    using value_type = std::vector<size_t>;
+
+    value_type identity() const {
+        return {};
+    }
+    void accumulate(value_type& result, const L& p) const {
+        m_counts.accumulate(result, std::pair<L, L>(p, p));
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        m_counts.merge(result, partial);
+    }
+private:
+    by_label<L, count<L>> m_counts;
+};
+
+// runs several reducers over the same pixels in one sweep, the result is the tuple of their results
+template<typename... reducers_T>
+struct combined {
+    using value_type = std::tuple<typename reducers_T::value_type...>;
+
+    std::tuple<reducers_T...> reducers;
+
+    value_type identity() const {
+        return std::apply([](const auto&... r) {
+            return value_type(r.identity()...);
+        }, reducers);
+    }
+    template<typename P>
+    void accumulate(value_type& result, const P& p) const {
+        for_each_reducer([&](const auto& r, auto& partial) {
+            r.accumulate(partial, p);
+        }, result, std::index_sequence_for<reducers_T...>());
+    }
+    void merge(value_type& result, const value_type& partial) const {
+        merge(result, partial, std::index_sequence_for<reducers_T...>());
+    }
+private:
+    template<typename F, size_t... i>
+    void for_each_reducer(const F& f, value_type& result, std::index_sequence<i...>) const {
+        (f(std::get<i>(reducers), std::get<i>(result)), ...);
+    }
+    template<size_t... i>
+    void merge(value_type& result, const value_type& partial, std::index_sequence<i...>) const {
+        (std::get<i>(reducers).merge(std::get<i>(result), std::get<i>(partial)), ...);
+    }
+};
+
+template<typename... reducers_T>
+combined<reducers_T...> combine(reducers_T... reducers) {
+    return {{std::move(reducers)...}};
+}
+
+// folds the pixels of an image or expression without storing them
+template<execution::policy policy_T, typename source_T, typename reducer_T>
+typename reducer_T::value_type reduce(const policy_T& policy, const source_T& src, const reducer_T& reducer) {
+    const auto& n = as_node(src);
+    size_t bands = 1;
+    if constexpr (execution::parallel<policy_T>) {
+        bands = thread_pool::shared().bands(n.height());
+    }
+    std::vector<typename reducer_T::value_type> partials(bands, reducer.identity());
+
+    auto process_rows = [&](auto band, auto begin, auto end) {
+        auto result = partials[band];
+        for (size_t y = begin; y < end; y++) {
+            if constexpr (requires { reducer.accumulate_row(result, n.row(y), n.width()); }) {
+                reducer.accumulate_row(result, n.row(y), n.width());
+            } else {
+                for (size_t x = 0; x < n.width(); x++) {
+                    reducer.accumulate(result, n(x, y));
+                }
+            }
+        }
+        partials[band] = result;
+    };
+
+    if constexpr (execution::parallel<policy_T>) {
+        thread_pool::shared().for_each_band(n.height(), process_rows);
+    } else {
+        process_rows(0, 0, n.height());
+    }
+
+    auto result = reducer.identity();
+    for (const auto& partial : partials) {
+        reducer.merge(result, partial);
+    }
+
+    return result;
+}
+
+// stores an expression in a new row-major image
+template<execution::policy policy_T, node node_T>
+image<typename node_T::value_type> evaluate(const policy_T& policy, const node_T& n) {
+    image<typename node_T::value_type> result(n.width(), n.height(), image_init::uninitialized);
+    result.assign(policy, n);
+
+    return result;
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+// maps pixel coordinates to an index into the backing storage of an image, layouts with a
+// halo reserve halo pixels on every side so x and y may go down to -halo and up to size + halo - 1
+
+class row_major_layout {
+public:
+    // row-major images are walked in bands of full rows
+    constexpr static const size_t tile_width = std::numeric_limits<size_t>::max();
+    constexpr static const size_t tile_height = 64;
+
+    row_major_layout() {}
+    row_major_layout(const size_t width, const size_t height, const size_t halo = 0) :
+        m_offset(halo * (width + 2 * halo) + halo),
+        m_row_stride(width + 2 * halo),
+        m_storage_size((width + 2 * halo) * (height + 2 * halo)),
+        m_halo(halo) {}
+
+    size_t storage_size() const {
+        return m_storage_size;
+    }
+    size_t halo() const {
+        return m_halo;
+    }
+    size_t index(const int x, const int y) const {
+        return m_offset + y * m_row_stride + x;
+    }
+    std::ptrdiff_t offset(const int dx, const int dy) const {
+        return static_cast<std::ptrdiff_t>(dy) * m_row_stride + dx;
+    }
+    row_major_layout subregion(const int x, const int y) const {
+        auto result = *this;
+        result.m_offset = index(x, y);
+        return result;
+    }
+    size_t tile_phase_x() const {
+        return 0;
+    }
+    size_t tile_phase_y() const {
+        return 0;
+    }
+private:
+    size_t m_offset;
+    size_t m_row_stride;
+    size_t m_storage_size;
+    size_t m_halo;
+};
+
+// stores the image as square blocks of tile_size x tile_size pixels, so vertical neighbours
+// are tile_size pixels apart instead of a full row
+template<size_t tile_size = 64>
+class tiled_layout {
+public:
+    static_assert(tile_size > 0 && (tile_size & (tile_size - 1)) == 0, "tile_size must be a power of two");
+
+    constexpr static const size_t tile_width = tile_size;
+    constexpr static const size_t tile_height = tile_size;
+
+    tiled_layout() {}
+    tiled_layout(const size_t width, const size_t height, const size_t halo = 0) :
+        m_origin_x(halo),
+        m_origin_y(halo),
+        m_tiles_per_row((width + 2 * halo + tile_size - 1) / tile_size),
+        m_tile_rows((height + 2 * halo + tile_size - 1) / tile_size),
+        m_halo(halo) {}
+
+    size_t storage_size() const {
+        return m_tiles_per_row * m_tile_rows * tile_size * tile_size;
+    }
+    size_t halo() const {
+        return m_halo;
+    }
+    size_t index(const int x, const int y) const {
+        size_t gx = m_origin_x + x;
+        size_t gy = m_origin_y + y;
+        size_t tile = (gy / tile_size) * m_tiles_per_row + gx / tile_size;
+
+        return tile * tile_size * tile_size + (gy % tile_size) * tile_size + gx % tile_size;
+    }
+    tiled_layout subregion(const int x, const int y) const {
+        auto result = *this;
+        result.m_origin_x += x;
+        result.m_origin_y += y;
+        return result;
+    }
+    size_t tile_phase_x() const {
+        return m_origin_x % tile_size;
+    }
+    size_t tile_phase_y() const {
+        return m_origin_y % tile_size;
+    }
+private:
+    size_t m_origin_x;
+    size_t m_origin_y;
+    size_t m_tiles_per_row;
+    size_t m_tile_rows;
+    size_t m_halo;
+};
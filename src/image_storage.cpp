@@ -0,0 +1,291 @@
+#include "image_storage.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+size_t budget_from_environment() {
+    if (auto value = std::getenv("MAPGEN_MEMORY_BUDGET")) {
+        return std::strtoull(value, nullptr, 10) * 1024 * 1024;
+    }
+
+    return std::numeric_limits<size_t>::max();
+}
+
+std::string temporary_directory() {
+    for (auto name : {"MAPGEN_TMPDIR", "TMPDIR"}) {
+        if (auto value = std::getenv(name)) {
+            return value;
+        }
+    }
+
+    return "/tmp";
+}
+
+std::atomic<size_t> budget_bytes = budget_from_environment();
+std::atomic<size_t> heap_bytes_in_use = 0;
+std::atomic<size_t> mapped_bytes_in_use = 0;
+
+bool try_reserve(const size_t bytes) {
+    size_t current = heap_bytes_in_use;
+
+    do {
+        if (current + bytes > budget_bytes) {
+            return false;
+        }
+    } while (!heap_bytes_in_use.compare_exchange_weak(current, current + bytes));
+
+    return true;
+}
+
+}
+
+void image_memory::set_budget(const size_t bytes) {
+    budget_bytes = bytes;
+
+    size_t current = heap_bytes_in_use;
+    if (current > bytes) {
+        image_buffer_pool::evict(current - bytes);
+    }
+}
+
+size_t image_memory::budget() {
+    return budget_bytes;
+}
+
+size_t image_memory::heap_bytes() {
+    return heap_bytes_in_use;
+}
+
+size_t image_memory::mapped_bytes() {
+    return mapped_bytes_in_use;
+}
+
+bool image_memory::try_reserve_heap(const size_t bytes) {
+    if (try_reserve(bytes)) {
+        return true;
+    }
+    // buffers cached by the pool count against the budget, they go before images are mapped
+    size_t current = heap_bytes_in_use;
+    if (bytes > budget_bytes || image_buffer_pool::stats().cached_bytes == 0) {
+        return false;
+    }
+    if (current + bytes > budget_bytes) {
+        image_buffer_pool::evict(current + bytes - budget_bytes);
+    }
+
+    return try_reserve(bytes);
+}
+
+void image_memory::reserve_heap(const size_t bytes) {
+    heap_bytes_in_use += bytes;
+}
+
+void image_memory::release_heap(const size_t bytes) {
+    heap_bytes_in_use -= bytes;
+}
+
+void* image_memory::map(const size_t bytes) {
+    if (bytes == 0) {
+        return nullptr;
+    }
+
+    auto path = temporary_directory() + "/mapgen-XXXXXX";
+    int fd = mkstemp(path.data());
+
+    if (fd < 0) {
+        std::perror("mapgen: could not create image file");
+        return nullptr;
+    }
+    // the file lives on as long as the mapping does
+    unlink(path.c_str());
+
+    if (ftruncate(fd, bytes) != 0) {
+        std::perror("mapgen: could not resize image file");
+        close(fd);
+        return nullptr;
+    }
+
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED) {
+        std::perror("mapgen: could not map image file");
+        return nullptr;
+    }
+    mapped_bytes_in_use += bytes;
+
+    return ptr;
+}
+
+void image_memory::unmap(void* ptr, const size_t bytes) {
+    munmap(ptr, bytes);
+    mapped_bytes_in_use -= bytes;
+}
+
+void image_memory::advise(void* ptr, const size_t bytes, const image_access access) {
+    int advice = MADV_NORMAL;
+
+    switch (access) {
+        case image_access::normal:
+            advice = MADV_NORMAL;
+            break;
+        case image_access::sequential:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case image_access::random:
+            advice = MADV_RANDOM;
+            break;
+        case image_access::will_need:
+            advice = MADV_WILLNEED;
+            break;
+        case image_access::dont_need:
+            advice = MADV_DONTNEED;
+            break;
+    }
+
+    madvise(ptr, bytes, advice);
+}
+
+namespace {
+
+constexpr size_t page_size = 4096;
+
+size_t capacity_from_environment() {
+    if (auto value = std::getenv("MAPGEN_POOL_CAPACITY")) {
+        return std::strtoull(value, nullptr, 10) * 1024 * 1024;
+    }
+
+    return size_t(1024) * 1024 * 1024;
+}
+
+size_t bucket_size(const size_t bytes) {
+    return (bytes + page_size - 1) / page_size * page_size;
+}
+
+struct buffer_pool_state {
+    std::mutex mutex;
+    std::unordered_map<size_t, std::vector<void*>> buckets;
+    size_t capacity = capacity_from_environment();
+    size_t cached_bytes = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+// never destroyed: images may still be released during static destruction, e.g. by jobs of the
+// shared thread_pool, whose threads only exit then
+buffer_pool_state& pool_state() {
+    static auto state = new buffer_pool_state();
+    return *state;
+}
+
+}
+
+void* image_buffer_pool::acquire(const size_t bytes) {
+    if (bytes == 0) {
+        return nullptr;
+    }
+
+    auto size = bucket_size(bytes);
+    auto& pool = pool_state();
+    {
+        std::unique_lock ul(pool.mutex);
+        auto it = pool.buckets.find(size);
+
+        if (it != pool.buckets.end() && !it->second.empty()) {
+            void* ptr = it->second.back();
+            it->second.pop_back();
+            pool.cached_bytes -= size;
+            pool.hits++;
+            // the caller has reserved the buffer for itself
+            image_memory::release_heap(size);
+            return ptr;
+        }
+        pool.misses++;
+    }
+
+    void* ptr = std::aligned_alloc(64, size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void image_buffer_pool::release(void* ptr, const size_t bytes) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    auto size = bucket_size(bytes);
+    auto& pool = pool_state();
+    {
+        std::unique_lock ul(pool.mutex);
+
+        // a cached buffer stays reserved, it is only kept while the budget has room for it
+        if (pool.cached_bytes + size <= std::min<size_t>(pool.capacity, budget_bytes) && try_reserve(size)) {
+            pool.buckets[size].push_back(ptr);
+            pool.cached_bytes += size;
+            return;
+        }
+    }
+
+    std::free(ptr);
+}
+
+void image_buffer_pool::evict(const size_t bytes) {
+    auto& pool = pool_state();
+    std::unique_lock ul(pool.mutex);
+    size_t freed = 0;
+
+    for (auto& [size, buffers] : pool.buckets) {
+        while (freed < bytes && !buffers.empty()) {
+            std::free(buffers.back());
+            buffers.pop_back();
+            pool.cached_bytes -= size;
+            image_memory::release_heap(size);
+            freed += size;
+        }
+    }
+}
+
+void image_buffer_pool::set_capacity(const size_t bytes) {
+    {
+        std::unique_lock ul(pool_state().mutex);
+        pool_state().capacity = bytes;
+    }
+    clear();
+}
+
+size_t image_buffer_pool::capacity() {
+    return pool_state().capacity;
+}
+
+void image_buffer_pool::clear() {
+    auto& pool = pool_state();
+    std::unique_lock ul(pool.mutex);
+
+    for (auto& [size, buffers] : pool.buckets) {
+        for (auto ptr : buffers) {
+            std::free(ptr);
+        }
+        image_memory::release_heap(size * buffers.size());
+    }
+    pool.buckets.clear();
+    pool.cached_bytes = 0;
+}
+
+image_buffer_pool::statistics image_buffer_pool::stats() {
+    auto& pool = pool_state();
+    std::unique_lock ul(pool.mutex);
+
+    return {pool.hits, pool.misses, pool.cached_bytes};
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <string>
+#include <iostream>
+#include <type_traits>
+#include <memory>
+
+enum class image_backing {
+    automatic,
+    heap,
+    mapped
+};
+
+// uninitialized skips zeroing heap buffers that are about to be overwritten completely
+enum class image_init {
+    zeroed,
+    uninitialized
+};
+
+enum class image_access {
+    normal,
+    sequential,
+    random,
+    will_need,
+    dont_need
+};
+
+// process wide accounting of image buffers, automatic buffers that do not fit into the heap
+// budget are placed in memory-mapped temporary files instead, after the buffer pool has given up
+// the buffers it caches, which count against the budget as well
+// the budget is unlimited unless MAPGEN_MEMORY_BUDGET (in MiB) is set or set_budget() is called,
+// the files are created in MAPGEN_TMPDIR, TMPDIR or /tmp
+class image_memory {
+public:
+    static void set_budget(const size_t bytes);
+    static size_t budget();
+    static size_t heap_bytes();
+    static size_t mapped_bytes();
+
+    static bool try_reserve_heap(const size_t bytes);
+    static void reserve_heap(const size_t bytes);
+    static void release_heap(const size_t bytes);
+
+    // returns zero filled memory or nullptr on failure
+    static void* map(const size_t bytes);
+    static void unmap(void* ptr, const size_t bytes);
+    static void advise(void* ptr, const size_t bytes, const image_access access);
+};
+
+// recycles freed heap buffers by size (rounded up to whole pages), so short-lived images
+// neither fault in fresh pages nor go through the allocator
+// at most capacity() bytes are kept and never more than the heap budget has room for,
+// MAPGEN_POOL_CAPACITY (in MiB) sets it at startup (default 1024)
+class image_buffer_pool {
+public:
+    struct statistics {
+        size_t hits;
+        size_t misses;
+        size_t cached_bytes;
+    };
+
+    // returns a 64 byte aligned buffer of at least bytes, nullptr for 0 bytes
+    static void* acquire(const size_t bytes);
+    // the caller releases its heap reservation of the buffer first
+    static void release(void* ptr, const size_t bytes);
+    // frees cached buffers until at least bytes are freed or the pool is empty
+    static void evict(const size_t bytes);
+
+    static void set_capacity(const size_t bytes);
+    static size_t capacity();
+    static void clear();
+    static statistics stats();
+};
+
+// pixel buffer shared between copies of an image, owners counts the images that
+// hold it by value and views the subregion views that write to it
+template<typename T>
+class image_storage {
+public:
+    explicit image_storage(const size_t size, const image_backing backing = image_backing::automatic, const image_init init = image_init::zeroed) : m_size(size) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            bool reserved = backing == image_backing::automatic && image_memory::try_reserve_heap(bytes());
+
+            if (backing == image_backing::mapped || (backing == image_backing::automatic && !reserved)) {
+                m_pixels = static_cast<T*>(image_memory::map(bytes()));
+                if (m_pixels != nullptr) {
+                    m_mapped = true;
+                    return;
+                }
+            }
+            if (reserved) {
+                allocate_heap(init);
+                return;
+            }
+        }
+
+        image_memory::reserve_heap(bytes());
+        allocate_heap(init);
+    }
+    ~image_storage() {
+        if (m_mapped) {
+            image_memory::unmap(m_pixels, bytes());
+        } else {
+            std::destroy_n(m_pixels, m_size);
+            image_memory::release_heap(bytes());
+            image_buffer_pool::release(m_pixels, bytes());
+        }
+    }
+    image_storage(const image_storage&) = delete;
+    void operator=(const image_storage&) = delete;
+
+    T* data() {
+        return m_pixels;
+    }
+    size_t size() const {
+        return m_size;
+    }
+    size_t bytes() const {
+        return m_size * sizeof(T);
+    }
+    bool mapped() const {
+        return m_mapped;
+    }
+    void advise(const image_access access) {
+        if (m_mapped) {
+            image_memory::advise(m_pixels, bytes(), access);
+        }
+    }
+
+    std::atomic<size_t> owners = 1;
+    std::atomic<size_t> views = 0;
+private:
+    void allocate_heap(const image_init init) {
+        m_pixels = static_cast<T*>(image_buffer_pool::acquire(bytes()));
+
+        if (init == image_init::uninitialized) {
+            std::uninitialized_default_construct_n(m_pixels, m_size);
+        } else {
+            std::uninitialized_value_construct_n(m_pixels, m_size);
+        }
+    }
+
+    size_t m_size;
+    T* m_pixels;
+    bool m_mapped = false;
+};
+
+// counts the bytes of all deep copies of image buffers
+struct image_copy_counter {
+    static std::atomic<size_t>& bytes() {
+        static std::atomic<size_t> counter = 0;
+        return counter;
+    }
+    static void add(const size_t n) {
+        bytes().fetch_add(n, std::memory_order_relaxed);
+    }
+};
+
+// reports the bytes copied and the buffer pool hits and misses since the previous report,
+// printing is enabled with MAPGEN_TRACK_COPIES
+class image_copy_tracker {
+public:
+    image_copy_tracker() : m_last(image_copy_counter::bytes()), m_last_pool(image_buffer_pool::stats()) {}
+
+    size_t report(const std::string& stage) {
+        size_t current = image_copy_counter::bytes();
+        size_t copied = current - m_last;
+        auto pool = image_buffer_pool::stats();
+        m_last = current;
+
+#ifdef MAPGEN_TRACK_COPIES
+        std::cout << stage << ": " << copied << " bytes copied, ";
+        std::cout << pool.hits - m_last_pool.hits << " pool hits, ";
+        std::cout << pool.misses - m_last_pool.misses << " pool misses, ";
+        std::cout << pool.cached_bytes << " bytes cached" << std::endl;
+#endif
+        m_last_pool = pool;
+
+        return copied;
+    }
+private:
+    size_t m_last;
+    image_buffer_pool::statistics m_last_pool;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "execution.h"
+#include "image.h"
+#include "simd.h"
+
+// integer region ids per pixel, 0 is outside of all regions
+using label_image = image<uint32_t>;
+
+// result(x, y) = lut[labels(x, y)], every label has to be an index of lut, float tables are read
+// with the gather kernel of simd
+template<typename T, execution::policy policy_T>
+image<T> remap(const policy_T& policy, const label_image& labels, const std::vector<T>& lut) {
+    image<T> result(labels.width(), labels.height(), image_init::uninitialized);
+
+    labels.for_each_row_band(policy, [&](auto band, auto begin, auto end) {
+        for (size_t y = begin; y < end; y++) {
+            auto src = labels.row(y);
+            auto dest = result.row(y);
+            if constexpr (std::is_same_v<T, float>) {
+                simd::gather(dest.data(), lut.data(), src.data(), src.size());
+            } else {
+                for (size_t x = 0; x < src.size(); x++) {
+                    dest[x] = lut[src[x]];
+                }
+            }
+        }
+    });
+
+    return result;
+}
+template<typename T>
+image<T> remap(const label_image& labels, const std::vector<T>& lut) {
+    return remap(execution::seq, labels, lut);
+}
@@ -1,9 +1,14 @@
+#include <algorithm>
 #include <vector>
 #include <iostream>
+#include <random>
+#include <string>
 
 #include "export_ppm.h"
 #include "helper.h"
 #include "config.h"
+#include "random_generator.h"
+#include "thread_pool.h"
 
 #include "generators/noise.h"
 #include "generators/shapes.h"
@@ -11,22 +16,41 @@
 #include "generators/water.h"
 #include "generators/biome.h"
 
-int main() {
+int main(int argc, char** argv) {
+    // the same seed always generates the same map
+    uint64_t seed = argc > 1 ? std::stoull(argv[1]) : std::random_device()();
+    random_seed::set(seed);
+    std::cout << "seed " << seed << std::endl;
+    // the number of threads never changes the map
+    if (argc > 2) {
+        thread_pool::configure(std::stoul(argv[2]));
+    }
+
     int width = 512;
     int height = 512;
     int scale = 20;
-    auto asd = mapgen::generators::noise::generate(width, height, scale, 0.1, 0.4, 0.1);
-
-    export_ppm("region2.ppm", asd);
-    //return 0;
+    image_copy_tracker copies;
+    // the noise is streamed into the file in bands, the whole canvas is never in memory
+    mapgen::generators::noise::source noise(width, height, scale);
+    export_ppm("region2.ppm", noise.width(), noise.height(), [&](const auto& write) {
+        noise.for_each_band(height, [&](int y, const image<float>& band) {
+            write(band);
+        });
+    });
+    copies.report("noise");
 
 
     auto result = *import_ppm<float>("region2.ppm");
+    copies.report("import");
     auto shapes = mapgen::generators::shapes::generate(result);
+    copies.report("shapes");
     auto [mask, terrain] = mapgen::generators::terrain::generate(shapes, result, width, height);
+    copies.report("terrain");
     auto [a, b] = mapgen::generators::water::generate(mask, terrain, shapes);
+    copies.report("water");
 
     auto biomes = mapgen::generators::biome::generate(terrain.rescale(width, height), b.rescale(width, height));
+    copies.report("biome");
 
     export_ppm("rwd.ppm", a);
     export_ppm("blub_r.ppm", b);
@@ -34,6 +58,10 @@ int main() {
     export_ppm("temperature.ppm", biomes.temperature);
     export_ppm("moisture.ppm", biomes.moisture);
     export_ppm("altitude.ppm", biomes.altitude);
+    // clamped first, out of range values do not fit into uint16_t and nan becomes 0
+    export_ppm("terrain.ppm", terrain.convert<uint16_t>([](float p) {
+        return std::min(1.0f, std::max(0.0f, p)) * 65535.0f + 0.5f;
+    }));
 
     return 0;
 }
@@ -3,7 +3,89 @@
 #include <random>
 #include <memory>
 #include <type_traits>
+#include <cstdint>
+#include <atomic>
+#include <string_view>
 
+// finalizer of splitmix64, a bijection that spreads every input bit over the whole output
+constexpr uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// counter-based generator: the i-th number of a stream is mix64(key + (i + 1) * gamma), which is
+// splitmix64, so a stream is two integers and any number can be computed from its index alone
+// sub streams for stages, tiles, rows or threads are derived from the key, a stream never depends
+// on how work is split between threads
+class random_stream {
+public:
+    using result_type = uint64_t;
+
+    constexpr explicit random_stream(const uint64_t key) : m_key(key) {}
+
+    constexpr static result_type min() {
+        return 0;
+    }
+    constexpr static result_type max() {
+        return UINT64_MAX;
+    }
+    result_type operator()() {
+        return at(m_counter++);
+    }
+    constexpr result_type at(const uint64_t i) const {
+        return mix64(m_key + (i + 1) * gamma);
+    }
+
+    constexpr random_stream derive(const uint64_t id) const {
+        return random_stream(mix64(m_key ^ mix64(id + gamma)));
+    }
+    constexpr random_stream derive(const std::string_view name) const {
+        // fnv-1a
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (auto c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        }
+        return derive(hash);
+    }
+
+    constexpr uint64_t key() const {
+        return m_key;
+    }
+private:
+    constexpr static const uint64_t gamma = 0x9e3779b97f4a7c15ull;
+
+    uint64_t m_key;
+    uint64_t m_counter = 0;
+};
+
+// uniform float in [min, bound) from the upper 24 bits of a random number
+inline float uniform_float(const uint64_t bits, const float min, const float bound) {
+    return min + (bits >> 40) * 0x1.0p-24f * (bound - min);
+}
+
+// seed of the whole map, every stage derives its streams from it, so a seed always generates the
+// same map, it is 0 until set() is called
+class random_seed {
+public:
+    static void set(const uint64_t seed) {
+        value().store(seed, std::memory_order_relaxed);
+    }
+    static uint64_t get() {
+        return value().load(std::memory_order_relaxed);
+    }
+    static random_stream stream(const std::string_view stage) {
+        return random_stream(get()).derive(stage);
+    }
+    static random_stream stream(const std::string_view stage, const uint64_t index) {
+        return stream(stage).derive(index);
+    }
+private:
+    static std::atomic<uint64_t>& value() {
+        static std::atomic<uint64_t> seed = 0;
+        return seed;
+    }
+};
 
 template<typename T>
 struct universal_uniform_distribution {
@@ -24,34 +106,31 @@ struct universal_uniform_distribution<T> {
     std::uniform_real_distribution<T> dis;
 };
 
-struct random_device_wrapper {
-    random_device_wrapper() : gen(rd()) {}
-    std::random_device rd;
-    std::mt19937 gen;
-};
-
 template<typename T>
 class uniform_random_number {
 public:
-    uniform_random_number(const T& min, const T& max, std::shared_ptr<random_device_wrapper>& wrapper) : m_dis(min, max), m_wrapper(wrapper) {}
+    uniform_random_number(const T& min, const T& max, std::shared_ptr<random_stream>& stream) : m_dis(min, max), m_stream(stream) {}
     const T& current() {
         return m_current;
     }
     const T& next() {
-        m_current = m_dis.dis(m_wrapper->gen);
+        m_current = m_dis.dis(*m_stream);
         return m_current;
     }
 private:
     T m_current;
     universal_uniform_distribution<T> m_dis;
-    std::shared_ptr<random_device_wrapper> m_wrapper;
+    std::shared_ptr<random_stream> m_stream;
 };
 
+// distributions created by one generator draw from its stream one after another
 class random_generator {
 public:
+    explicit random_generator(const random_stream& stream) : m_stream(std::make_shared<random_stream>(stream)) {}
+
     template<typename T>
     auto uniform(const T& min, const T& max) {
-        return uniform_random_number(min, max, m_wrapper);
+        return uniform_random_number(min, max, m_stream);
     }
     bool roll_percentage(const int percent) {
         auto dis = uniform<int>(1, 100);
@@ -68,5 +147,5 @@ public:
         return container.at(dis.next());
     }
 private:
-    std::shared_ptr<random_device_wrapper> m_wrapper = std::make_shared<random_device_wrapper>();
+    std::shared_ptr<random_stream> m_stream;
 };
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// draws distinct pixels uniformly from the pixels selected(x, y) accepts in O(1) without retries:
+// the candidates are collected once, a drawn pixel is replaced by the last candidate
+class pixel_sampler {
+public:
+    template<typename F>
+    pixel_sampler(const size_t width, const size_t height, const F& selected) {
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                if (selected(x, y)) {
+                    m_pixels.push_back({x, y});
+                }
+            }
+        }
+    }
+
+    size_t size() const {
+        return m_pixels.size();
+    }
+    bool empty() const {
+        return m_pixels.empty();
+    }
+
+    // u is uniform in [0, 1), nullopt once every candidate has been drawn
+    std::optional<std::pair<int, int>> draw(const double u) {
+        if (m_pixels.empty()) {
+            return std::nullopt;
+        }
+
+        auto i = std::min(m_pixels.size() - 1, static_cast<size_t>(u * m_pixels.size()));
+        auto result = m_pixels[i];
+        m_pixels[i] = m_pixels.back();
+        m_pixels.pop_back();
+
+        return result;
+    }
+private:
+    std::vector<std::pair<int, int>> m_pixels;
+};
+
+// draws pixels with a probability proportional to weight(x, y) in O(log n) per draw and
+// O(log^2 n) per update, a fenwick tree over the pixels in row-major order holds the prefix sums of
+// the weights
+// an update recomputes the nodes above the pixel from their children instead of adding the
+// difference, so a node is exactly 0 iff every weight below it is 0 and the total never drifts
+class weighted_pixel_sampler {
+public:
+    template<typename F>
+    weighted_pixel_sampler(const size_t width, const size_t height, const F& weight) : m_width(width), m_weights(width * height), m_tree(width * height + 1, 0.0) {
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                m_weights[y * width + x] = std::max(0.0f, static_cast<float>(weight(x, y)));
+            }
+        }
+
+        for (size_t i = 1; i < m_tree.size(); i++) {
+            m_tree[i] += m_weights[i - 1];
+            auto parent = i + (i & -i);
+            if (parent < m_tree.size()) {
+                m_tree[parent] += m_tree[i];
+            }
+        }
+    }
+
+    // the sum of the top-level nodes of the tree
+    double total() const {
+        double result = 0.0;
+        for (auto j = m_weights.size(); j > 0; j -= j & -j) {
+            result += m_tree[j];
+        }
+
+        return result;
+    }
+    float weight(const int x, const int y) const {
+        return m_weights[y * m_width + x];
+    }
+    void set_weight(const int x, const int y, const float weight) {
+        auto i = y * m_width + x;
+        m_weights[i] = std::max(0.0f, weight);
+
+        // node j covers its own pixel and the nodes j - 1, j - 2, j - 4, ... below its lowest bit
+        for (auto j = i + 1; j < m_tree.size(); j += j & -j) {
+            double sum = m_weights[j - 1];
+            for (size_t step = 1; step < (j & -j); step *= 2) {
+                sum += m_tree[j - step];
+            }
+            m_tree[j] = sum;
+        }
+    }
+
+    // u is uniform in [0, 1), nullopt once all weights are 0
+    std::optional<std::pair<int, int>> draw(const double u) const {
+        size_t n = m_weights.size();
+        auto sum = total();
+        if (n == 0 || sum <= 0) {
+            return std::nullopt;
+        }
+
+        // largest number of leading pixels whose weights sum up to at most u * total, last is the
+        // last node of them that is above 0
+        double target = u * sum;
+        size_t i = 0;
+        size_t last = 0;
+        for (size_t step = std::bit_floor(n); step > 0; step /= 2) {
+            if (i + step <= n && m_tree[i + step] <= target) {
+                i += step;
+                target -= m_tree[i];
+                if (m_tree[i] > 0) {
+                    last = i;
+                }
+            }
+        }
+
+        // rounding can end on a pixel of weight 0 or past the last pixel, the nodes taken before
+        // cannot all be 0 then, the last positive pixel below them is the one before it
+        if (i == n || m_weights[i] == 0) {
+            i = last_positive(last);
+        }
+
+        return std::pair<int, int>(i % m_width, i / m_width);
+    }
+private:
+    // the last pixel of a weight above 0 below node j, which has to be above 0
+    size_t last_positive(size_t j) const {
+        while (m_weights[j - 1] == 0) {
+            size_t step = 1;
+            while (m_tree[j - step] == 0) {
+                step *= 2;
+            }
+            j -= step;
+        }
+
+        return j - 1;
+    }
+
+    size_t m_width;
+    std::vector<float> m_weights;
+    std::vector<double> m_tree;
+};
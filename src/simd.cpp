@@ -0,0 +1,545 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <limits>
+#include <immintrin.h>
+
+namespace simd {
+namespace {
+
+struct kernels {
+    void (*add)(float*, const float*, const size_t);
+    void (*max)(float*, const float*, const size_t);
+    void (*minmax)(const float*, const size_t, float&, float&);
+    void (*shift_and_scale)(float*, const size_t, const float, const float);
+    void (*lower_threshold)(float*, const size_t, const float, const float, const bool);
+    void (*reverse)(float*, const size_t);
+    void (*blur3)(float*, const float*, const size_t);
+    void (*blur3_rows)(float*, const float*, const float*, const float*, const size_t);
+    void (*blur2_rows)(float*, const float*, const float*, const size_t);
+    void (*threshold_scale_add)(float*, const float*, const size_t, const float, const float, const float, const float);
+    void (*gather)(float*, const float*, const uint32_t*, const size_t);
+    void (*weighted_sum)(float*, const float* const*, const float*, const size_t, const size_t);
+    const char* name;
+};
+
+namespace scalar {
+
+void add(float* dest, const float* src, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dest[i] += src[i];
+    }
+}
+
+void max(float* dest, const float* src, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dest[i] = std::max(dest[i], src[i]);
+    }
+}
+
+void minmax(const float* src, const size_t n, float& min, float& max) {
+    for (size_t i = 0; i < n; i++) {
+        min = std::min(min, src[i]);
+        max = std::max(max, src[i]);
+    }
+}
+
+void shift_and_scale(float* dest, const size_t n, const float offset, const float factor) {
+    for (size_t i = 0; i < n; i++) {
+        dest[i] = (dest[i] + offset) * factor;
+    }
+}
+
+void lower_threshold(float* dest, const size_t n, const float v, const float s, const bool inclusive) {
+    for (size_t i = 0; i < n; i++) {
+        if (dest[i] < v || (inclusive && dest[i] == v)) {
+            dest[i] = s;
+        }
+    }
+}
+
+void reverse(float* dest, const size_t n) {
+    std::reverse(dest, dest + n);
+}
+
+// all implementations add in the same order, so the results do not depend on the cpu
+float blur3(const float left, const float center, const float right) {
+    return ((left + right) + (center + center)) * 0.25f;
+}
+
+float blur2(const float center, const float neighbor) {
+    return ((center + center) + neighbor) / 3.0f;
+}
+
+void blur3_rows(float* dest, const float* above, const float* center, const float* below, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dest[i] = blur3(above[i], center[i], below[i]);
+    }
+}
+
+void blur2_rows(float* dest, const float* center, const float* neighbor, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dest[i] = blur2(center[i], neighbor[i]);
+    }
+}
+
+// adds src clamped to threshold and rescaled by min and factor, weighted by b
+void threshold_scale_add(float* dest, const float* src, const size_t n, const float threshold, const float min, const float factor, const float b) {
+    for (size_t i = 0; i < n; i++) {
+        float p = (std::max(src[i], threshold) - min) * factor;
+        dest[i] += std::max(0.0f, b * p);
+    }
+}
+
+void gather(float* dest, const float* table, const uint32_t* indices, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dest[i] = table[indices[i]];
+    }
+}
+
+// every element adds the weighted rows in the order of k
+void weighted_sum_range(float* dest, const float* const* rows, const float* weights, const size_t count, const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < count; k++) {
+            sum += weights[k] * rows[k][i];
+        }
+        dest[i] = sum;
+    }
+}
+
+void weighted_sum(float* dest, const float* const* rows, const float* weights, const size_t count, const size_t n) {
+    weighted_sum_range(dest, rows, weights, count, 0, n);
+}
+
+// blurs [begin, end) of the interior, the caller handles the ends
+void blur3_interior(float* dest, const float* src, const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        dest[i] = blur3(src[i - 1], src[i], src[i + 1]);
+    }
+}
+
+void blur3_ends(float* dest, const float* src, const size_t n) {
+    if (n == 1) {
+        dest[0] = src[0];
+        return;
+    }
+    dest[0] = blur2(src[0], src[1]);
+    dest[n - 1] = blur2(src[n - 1], src[n - 2]);
+}
+
+void blur3(float* dest, const float* src, const size_t n) {
+    if (n == 0) {
+        return;
+    }
+    blur3_ends(dest, src, n);
+    blur3_interior(dest, src, 1, n - 1);
+}
+
+}
+
+namespace sse42 {
+
+__attribute__((target("sse4.2")))
+void add(float* dest, const float* src, const size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_loadu_ps(src + i)));
+    }
+    scalar::add(dest + i, src + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+void max(float* dest, const float* src, const size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dest + i, _mm_max_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(dest + i)));
+    }
+    scalar::max(dest + i, src + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+void minmax(const float* src, const size_t n, float& min, float& max) {
+    size_t i = 0;
+    if (n >= 4) {
+        auto min_v = _mm_set1_ps(min);
+        auto max_v = _mm_set1_ps(max);
+        for (; i + 4 <= n; i += 4) {
+            auto v = _mm_loadu_ps(src + i);
+            min_v = _mm_min_ps(v, min_v);
+            max_v = _mm_max_ps(v, max_v);
+        }
+        float mins[4];
+        float maxs[4];
+        _mm_storeu_ps(mins, min_v);
+        _mm_storeu_ps(maxs, max_v);
+        scalar::minmax(mins, 4, min, max);
+        scalar::minmax(maxs, 4, min, max);
+    }
+    scalar::minmax(src + i, n - i, min, max);
+}
+
+__attribute__((target("sse4.2")))
+void shift_and_scale(float* dest, const size_t n, const float offset, const float factor) {
+    auto offset_v = _mm_set1_ps(offset);
+    auto factor_v = _mm_set1_ps(factor);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(dest + i), offset_v), factor_v));
+    }
+    scalar::shift_and_scale(dest + i, n - i, offset, factor);
+}
+
+__attribute__((target("sse4.2")))
+void lower_threshold(float* dest, const size_t n, const float v, const float s, const bool inclusive) {
+    auto v_v = _mm_set1_ps(v);
+    auto s_v = _mm_set1_ps(s);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto p = _mm_loadu_ps(dest + i);
+        auto mask = inclusive ? _mm_cmple_ps(p, v_v) : _mm_cmplt_ps(p, v_v);
+        _mm_storeu_ps(dest + i, _mm_blendv_ps(p, s_v, mask));
+    }
+    scalar::lower_threshold(dest + i, n - i, v, s, inclusive);
+}
+
+__attribute__((target("sse4.2")))
+void reverse(float* dest, const size_t n) {
+    size_t i = 0;
+    size_t j = n;
+    for (; i + 8 <= j; i += 4, j -= 4) {
+        auto front = _mm_loadu_ps(dest + i);
+        auto back = _mm_loadu_ps(dest + j - 4);
+        _mm_storeu_ps(dest + i, _mm_shuffle_ps(back, back, _MM_SHUFFLE(0, 1, 2, 3)));
+        _mm_storeu_ps(dest + j - 4, _mm_shuffle_ps(front, front, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+    scalar::reverse(dest + i, j - i);
+}
+
+__attribute__((target("sse4.2")))
+void blur3(float* dest, const float* src, const size_t n) {
+    if (n == 0) {
+        return;
+    }
+    auto quarter = _mm_set1_ps(0.25f);
+    size_t i = 1;
+    for (; i + 4 < n; i += 4) {
+        auto left = _mm_loadu_ps(src + i - 1);
+        auto center = _mm_loadu_ps(src + i);
+        auto right = _mm_loadu_ps(src + i + 1);
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_add_ps(_mm_add_ps(left, right), _mm_add_ps(center, center)), quarter));
+    }
+    scalar::blur3_interior(dest, src, i, n - 1);
+    scalar::blur3_ends(dest, src, n);
+}
+
+__attribute__((target("sse4.2")))
+void blur3_rows(float* dest, const float* above, const float* center, const float* below, const size_t n) {
+    auto quarter = _mm_set1_ps(0.25f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto c = _mm_loadu_ps(center + i);
+        auto outer = _mm_add_ps(_mm_loadu_ps(above + i), _mm_loadu_ps(below + i));
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_add_ps(outer, _mm_add_ps(c, c)), quarter));
+    }
+    scalar::blur3_rows(dest + i, above + i, center + i, below + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+void blur2_rows(float* dest, const float* center, const float* neighbor, const size_t n) {
+    auto three = _mm_set1_ps(3.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto c = _mm_loadu_ps(center + i);
+        _mm_storeu_ps(dest + i, _mm_div_ps(_mm_add_ps(_mm_add_ps(c, c), _mm_loadu_ps(neighbor + i)), three));
+    }
+    scalar::blur2_rows(dest + i, center + i, neighbor + i, n - i);
+}
+
+// _mm_max_ps(a, b) is a > b ? a : b, so std::max(a, b) is _mm_max_ps(b, a), also for ties
+__attribute__((target("sse4.2")))
+void threshold_scale_add(float* dest, const float* src, const size_t n, const float threshold, const float min, const float factor, const float b) {
+    auto t = _mm_set1_ps(threshold);
+    auto m = _mm_set1_ps(min);
+    auto f = _mm_set1_ps(factor);
+    auto s = _mm_set1_ps(b);
+    auto zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto p = _mm_mul_ps(_mm_sub_ps(_mm_max_ps(t, _mm_loadu_ps(src + i)), m), f);
+        auto v = _mm_max_ps(_mm_mul_ps(s, p), zero);
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), v));
+    }
+    scalar::threshold_scale_add(dest + i, src + i, n - i, threshold, min, factor, b);
+}
+
+
+// four independent sums per step, so the additions do not wait for each other
+__attribute__((target("sse4.2")))
+void weighted_sum(float* dest, const float* const* rows, const float* weights, const size_t count, const size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto s0 = _mm_setzero_ps();
+        auto s1 = _mm_setzero_ps();
+        auto s2 = _mm_setzero_ps();
+        auto s3 = _mm_setzero_ps();
+        for (size_t k = 0; k < count; k++) {
+            auto w = _mm_set1_ps(weights[k]);
+            const float* r = rows[k] + i;
+            s0 = _mm_add_ps(s0, _mm_mul_ps(w, _mm_loadu_ps(r)));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(w, _mm_loadu_ps(r + 4)));
+            s2 = _mm_add_ps(s2, _mm_mul_ps(w, _mm_loadu_ps(r + 8)));
+            s3 = _mm_add_ps(s3, _mm_mul_ps(w, _mm_loadu_ps(r + 12)));
+        }
+        _mm_storeu_ps(dest + i, s0);
+        _mm_storeu_ps(dest + i + 4, s1);
+        _mm_storeu_ps(dest + i + 8, s2);
+        _mm_storeu_ps(dest + i + 12, s3);
+    }
+    scalar::weighted_sum_range(dest, rows, weights, count, i, n);
+}
+
+}
+
+namespace avx2 {
+
+__attribute__((target("avx2")))
+void add(float* dest, const float* src, const size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), _mm256_loadu_ps(src + i)));
+    }
+    scalar::add(dest + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void max(float* dest, const float* src, const size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dest + i, _mm256_max_ps(_mm256_loadu_ps(src + i), _mm256_loadu_ps(dest + i)));
+    }
+    scalar::max(dest + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void minmax(const float* src, const size_t n, float& min, float& max) {
+    size_t i = 0;
+    if (n >= 8) {
+        auto min_v = _mm256_set1_ps(min);
+        auto max_v = _mm256_set1_ps(max);
+        for (; i + 8 <= n; i += 8) {
+            auto v = _mm256_loadu_ps(src + i);
+            min_v = _mm256_min_ps(v, min_v);
+            max_v = _mm256_max_ps(v, max_v);
+        }
+        float mins[8];
+        float maxs[8];
+        _mm256_storeu_ps(mins, min_v);
+        _mm256_storeu_ps(maxs, max_v);
+        scalar::minmax(mins, 8, min, max);
+        scalar::minmax(maxs, 8, min, max);
+    }
+    scalar::minmax(src + i, n - i, min, max);
+}
+
+__attribute__((target("avx2")))
+void shift_and_scale(float* dest, const size_t n, const float offset, const float factor) {
+    auto offset_v = _mm256_set1_ps(offset);
+    auto factor_v = _mm256_set1_ps(factor);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(dest + i), offset_v), factor_v));
+    }
+    scalar::shift_and_scale(dest + i, n - i, offset, factor);
+}
+
+__attribute__((target("avx2")))
+void lower_threshold(float* dest, const size_t n, const float v, const float s, const bool inclusive) {
+    auto v_v = _mm256_set1_ps(v);
+    auto s_v = _mm256_set1_ps(s);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto p = _mm256_loadu_ps(dest + i);
+        auto mask = inclusive ? _mm256_cmp_ps(p, v_v, _CMP_LE_OQ) : _mm256_cmp_ps(p, v_v, _CMP_LT_OQ);
+        _mm256_storeu_ps(dest + i, _mm256_blendv_ps(p, s_v, mask));
+    }
+    scalar::lower_threshold(dest + i, n - i, v, s, inclusive);
+}
+
+__attribute__((target("avx2")))
+void reverse(float* dest, const size_t n) {
+    const auto reversed = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    size_t i = 0;
+    size_t j = n;
+    for (; i + 16 <= j; i += 8, j -= 8) {
+        auto front = _mm256_loadu_ps(dest + i);
+        auto back = _mm256_loadu_ps(dest + j - 8);
+        _mm256_storeu_ps(dest + i, _mm256_permutevar8x32_ps(back, reversed));
+        _mm256_storeu_ps(dest + j - 8, _mm256_permutevar8x32_ps(front, reversed));
+    }
+    scalar::reverse(dest + i, j - i);
+}
+
+__attribute__((target("avx2")))
+void blur3(float* dest, const float* src, const size_t n) {
+    if (n == 0) {
+        return;
+    }
+    auto quarter = _mm256_set1_ps(0.25f);
+    size_t i = 1;
+    for (; i + 8 < n; i += 8) {
+        auto left = _mm256_loadu_ps(src + i - 1);
+        auto center = _mm256_loadu_ps(src + i);
+        auto right = _mm256_loadu_ps(src + i + 1);
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(left, right), _mm256_add_ps(center, center)), quarter));
+    }
+    scalar::blur3_interior(dest, src, i, n - 1);
+    scalar::blur3_ends(dest, src, n);
+}
+
+__attribute__((target("avx2")))
+void blur3_rows(float* dest, const float* above, const float* center, const float* below, const size_t n) {
+    auto quarter = _mm256_set1_ps(0.25f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto c = _mm256_loadu_ps(center + i);
+        auto outer = _mm256_add_ps(_mm256_loadu_ps(above + i), _mm256_loadu_ps(below + i));
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_add_ps(outer, _mm256_add_ps(c, c)), quarter));
+    }
+    scalar::blur3_rows(dest + i, above + i, center + i, below + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void blur2_rows(float* dest, const float* center, const float* neighbor, const size_t n) {
+    auto three = _mm256_set1_ps(3.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto c = _mm256_loadu_ps(center + i);
+        _mm256_storeu_ps(dest + i, _mm256_div_ps(_mm256_add_ps(_mm256_add_ps(c, c), _mm256_loadu_ps(neighbor + i)), three));
+    }
+    scalar::blur2_rows(dest + i, center + i, neighbor + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void threshold_scale_add(float* dest, const float* src, const size_t n, const float threshold, const float min, const float factor, const float b) {
+    auto t = _mm256_set1_ps(threshold);
+    auto m = _mm256_set1_ps(min);
+    auto f = _mm256_set1_ps(factor);
+    auto s = _mm256_set1_ps(b);
+    auto zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto p = _mm256_mul_ps(_mm256_sub_ps(_mm256_max_ps(t, _mm256_loadu_ps(src + i)), m), f);
+        auto v = _mm256_max_ps(_mm256_mul_ps(s, p), zero);
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), v));
+    }
+    scalar::threshold_scale_add(dest + i, src + i, n - i, threshold, min, factor, b);
+}
+
+__attribute__((target("avx2")))
+void gather(float* dest, const float* table, const uint32_t* indices, const size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+        _mm256_storeu_ps(dest + i, _mm256_i32gather_ps(table, index, 4));
+    }
+    scalar::gather(dest + i, table, indices + i, n - i);
+}
+
+
+__attribute__((target("avx2")))
+void weighted_sum(float* dest, const float* const* rows, const float* weights, const size_t count, const size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        auto s0 = _mm256_setzero_ps();
+        auto s1 = _mm256_setzero_ps();
+        auto s2 = _mm256_setzero_ps();
+        auto s3 = _mm256_setzero_ps();
+        for (size_t k = 0; k < count; k++) {
+            auto w = _mm256_set1_ps(weights[k]);
+            const float* r = rows[k] + i;
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(w, _mm256_loadu_ps(r)));
+            s1 = _mm256_add_ps(s1, _mm256_mul_ps(w, _mm256_loadu_ps(r + 8)));
+            s2 = _mm256_add_ps(s2, _mm256_mul_ps(w, _mm256_loadu_ps(r + 16)));
+            s3 = _mm256_add_ps(s3, _mm256_mul_ps(w, _mm256_loadu_ps(r + 24)));
+        }
+        _mm256_storeu_ps(dest + i, s0);
+        _mm256_storeu_ps(dest + i + 8, s1);
+        _mm256_storeu_ps(dest + i + 16, s2);
+        _mm256_storeu_ps(dest + i + 24, s3);
+    }
+    scalar::weighted_sum_range(dest, rows, weights, count, i, n);
+}
+
+}
+
+const kernels& dispatch() {
+    static const kernels selected = []() -> kernels {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {avx2::add, avx2::max, avx2::minmax, avx2::shift_and_scale, avx2::lower_threshold, avx2::reverse, avx2::blur3, avx2::blur3_rows, avx2::blur2_rows, avx2::threshold_scale_add, avx2::gather, avx2::weighted_sum, "avx2"};
+        }
+        if (__builtin_cpu_supports("sse4.2")) {
+            return {sse42::add, sse42::max, sse42::minmax, sse42::shift_and_scale, sse42::lower_threshold, sse42::reverse, sse42::blur3, sse42::blur3_rows, sse42::blur2_rows, sse42::threshold_scale_add, scalar::gather, sse42::weighted_sum, "sse4.2"};
+        }
+        return {scalar::add, scalar::max, scalar::minmax, scalar::shift_and_scale, scalar::lower_threshold, scalar::reverse, scalar::blur3, scalar::blur3_rows, scalar::blur2_rows, scalar::threshold_scale_add, scalar::gather, scalar::weighted_sum, "scalar"};
+    }();
+
+    return selected;
+}
+
+}
+
+void add(float* dest, const float* src, const size_t n) {
+    dispatch().add(dest, src, n);
+}
+
+void max(float* dest, const float* src, const size_t n) {
+    dispatch().max(dest, src, n);
+}
+
+void minmax(const float* src, const size_t n, float& min, float& max) {
+    dispatch().minmax(src, n, min, max);
+}
+
+void shift_and_scale(float* dest, const size_t n, const float offset, const float factor) {
+    dispatch().shift_and_scale(dest, n, offset, factor);
+}
+
+void lower_threshold(float* dest, const size_t n, const float v, const float s, const bool inclusive) {
+    dispatch().lower_threshold(dest, n, v, s, inclusive);
+}
+
+void reverse(float* dest, const size_t n) {
+    dispatch().reverse(dest, n);
+}
+
+void blur3(float* dest, const float* src, const size_t n) {
+    dispatch().blur3(dest, src, n);
+}
+
+void blur3_rows(float* dest, const float* above, const float* center, const float* below, const size_t n) {
+    dispatch().blur3_rows(dest, above, center, below, n);
+}
+
+void blur2_rows(float* dest, const float* center, const float* neighbor, const size_t n) {
+    dispatch().blur2_rows(dest, center, neighbor, n);
+}
+
+void threshold_scale_add(float* dest, const float* src, const size_t n, const float threshold, const float min, const float factor, const float b) {
+    dispatch().threshold_scale_add(dest, src, n, threshold, min, factor, b);
+}
+
+void gather(float* dest, const float* table, const uint32_t* indices, const size_t n) {
+    dispatch().gather(dest, table, indices, n);
+}
+
+void weighted_sum(float* dest, const float* const* rows, const float* weights, const size_t count, const size_t n) {
+    dispatch().weighted_sum(dest, rows, weights, count, n);
+}
+
+const char* implementation() {
+    return dispatch().name;
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// element-wise kernels over contiguous float rows, the implementation (avx2, sse4.2 or
+// scalar) is picked once at runtime from the features of the cpu
+namespace simd {
+
+void add(float* dest, const float* src, const size_t n);
+void max(float* dest, const float* src, const size_t n);
+void minmax(const float* src, const size_t n, float& min, float& max);
+// dest = (dest + offset) * factor
+void shift_and_scale(float* dest, const size_t n, const float offset, const float factor);
+// replaces all values below v (or equal to v if inclusive) by s
+void lower_threshold(float* dest, const size_t n, const float v, const float s, const bool inclusive);
+void reverse(float* dest, const size_t n);
+// dest = src convolved with [1 2 1] / 4, cut off and renormalized to [2 1] / 3 at both ends
+void blur3(float* dest, const float* src, const size_t n);
+// dest = (above + 2 * center + below) / 4
+void blur3_rows(float* dest, const float* above, const float* center, const float* below, const size_t n);
+// dest = (2 * center + neighbor) / 3, the cut off kernel of blur3_rows for the first and last row
+void blur2_rows(float* dest, const float* center, const float* neighbor, const size_t n);
+// dest += max(0, b * (max(src, threshold) - min) * factor), the clamped and rescaled src scaled by b
+void threshold_scale_add(float* dest, const float* src, const size_t n, const float threshold, const float min, const float factor, const float b);
+// dest[i] = table[indices[i]], every index has to be below 2^31
+void gather(float* dest, const float* table, const uint32_t* indices, const size_t n);
+// dest[i] = sum of weights[k] * rows[k][i] over k in [0, count), added in the order of k
+void weighted_sum(float* dest, const float* const* rows, const float* weights, const size_t count, const size_t n);
+
+const char* implementation();
+
+}
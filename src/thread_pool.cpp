@@ -0,0 +1,140 @@
+#include "thread_pool.h"
+
+namespace {
+
+// the pool the current thread works for and the index of its queue
+thread_local const thread_pool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+std::unique_ptr<thread_pool>& shared_instance() {
+    static std::unique_ptr<thread_pool> pool = std::make_unique<thread_pool>(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+}
+
+thread_pool::thread_pool(const size_t workers) {
+    for (size_t i = 0; i < workers + 1; i++) {
+        m_queues.push_back(std::make_unique<queue>());
+    }
+    for (size_t i = 0; i < workers; i++) {
+        m_workers.emplace_back([this, i]() {
+            work(i + 1);
+        });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::unique_lock ul(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (auto& t : m_workers) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+thread_pool& thread_pool::shared() {
+    return *shared_instance();
+}
+
+void thread_pool::configure(const size_t threads) {
+    shared_instance() = std::make_unique<thread_pool>(std::max<size_t>(1, threads) - 1);
+}
+
+void thread_pool::push(std::function<void()> job) {
+    auto index = current_pool == this ? current_queue : 0;
+    {
+        std::unique_lock ul(m_queues[index]->mutex);
+        m_queues[index]->jobs.push_back(std::move(job));
+        m_pending++;
+    }
+
+    // taking the lock orders the notification after the check of a thread about to sleep
+    {
+        std::unique_lock ul(m_mutex);
+    }
+    m_cv.notify_one();
+}
+
+void thread_pool::notify() {
+    {
+        std::unique_lock ul(m_mutex);
+    }
+    m_cv.notify_all();
+}
+
+bool thread_pool::run_pending() {
+    auto job = take(current_pool == this ? current_queue : 0);
+    if (!job) {
+        return false;
+    }
+    job();
+
+    return true;
+}
+
+std::function<void()> thread_pool::pop(const size_t index) {
+    auto& q = *m_queues[index];
+    std::unique_lock ul(q.mutex);
+    if (q.jobs.empty()) {
+        return {};
+    }
+    auto job = std::move(q.jobs.back());
+    q.jobs.pop_back();
+    m_pending--;
+
+    return job;
+}
+
+std::function<void()> thread_pool::steal(const size_t index) {
+    for (size_t i = 1; i < m_queues.size(); i++) {
+        auto& q = *m_queues[(index + i) % m_queues.size()];
+        std::unique_lock ul(q.mutex);
+        if (q.jobs.empty()) {
+            continue;
+        }
+        auto job = std::move(q.jobs.front());
+        q.jobs.pop_front();
+        m_pending--;
+
+        return job;
+    }
+
+    return {};
+}
+
+std::function<void()> thread_pool::take(const size_t index) {
+    if (m_pending == 0) {
+        return {};
+    }
+    if (auto job = pop(index)) {
+        return job;
+    }
+
+    return steal(index);
+}
+
+void thread_pool::work(const size_t index) {
+    current_pool = this;
+    current_queue = index;
+
+    while (true) {
+        if (auto job = take(index)) {
+            job();
+            continue;
+        }
+
+        std::unique_lock ul(m_mutex);
+        m_cv.wait(ul, [this]() {
+            return m_stop || m_pending > 0;
+        });
+        if (m_stop && m_pending == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+
+// work-stealing scheduler: every worker owns a queue, it runs its newest job first and steals the
+// oldest job of another queue when its own is empty, threads outside of the pool push into a
+// shared queue that everybody steals from
+// waiting threads only sleep while no job is pending, they run the others, so tasks may wait for tasks
+class thread_pool {
+public:
+    explicit thread_pool(const size_t workers);
+    ~thread_pool();
+    thread_pool(const thread_pool&) = delete;
+    void operator=(const thread_pool&) = delete;
+
+    static thread_pool& shared();
+    // replaces the shared pool by one with threads - 1 workers (the caller is the last thread), must
+    // not be called while the shared pool is running jobs
+    static void configure(const size_t threads);
+
+    size_t concurrency() const {
+        return m_workers.size() + 1;
+    }
+    size_t bands(const size_t n) const {
+        return std::max<size_t>(1, std::min(n, concurrency()));
+    }
+
+    void push(std::function<void()> job);
+    // runs one pending job, returns false if there was none
+    bool run_pending();
+    // runs pending jobs until done() is true and sleeps while there are none, whoever makes done()
+    // true has to call notify() afterwards
+    template<typename exec_T>
+    void run_until(const exec_T& done) {
+        while (!done()) {
+            if (run_pending()) {
+                continue;
+            }
+            std::unique_lock ul(m_mutex);
+            m_cv.wait(ul, [&]() {
+                return m_pending > 0 || done();
+            });
+        }
+    }
+    void notify();
+
+    // splits [0, n) into bands(n) contiguous bands and calls call(band, begin, end) for each
+    // band, the calling thread works on the first band and helps out until all bands are done
+    template<typename exec_T>
+        requires std::invocable<exec_T, size_t, size_t, size_t>
+    void for_each_band(const size_t n, const exec_T& call);
+
+    // calls call(i) for every i in [begin, end), the range is split in halves down to grain
+    // indices, so idle threads steal the largest pieces left
+    template<typename exec_T>
+        requires std::invocable<exec_T, size_t>
+    void parallel_for(const size_t begin, const size_t end, const exec_T& call, const size_t grain = 1);
+
+    // runs call() on the pool (right away on a pool without workers), get() on the future blocks
+    // without running other jobs, so tasks should wait for other tasks with a task_group instead
+    template<typename exec_T>
+    auto submit(exec_T call) -> std::future<std::invoke_result_t<exec_T>> {
+        using result_T = std::invoke_result_t<exec_T>;
+        auto task = std::make_shared<std::packaged_task<result_T()>>(std::move(call));
+        auto result = task->get_future();
+        // without workers nobody else would ever run it
+        if (m_workers.empty()) {
+            (*task)();
+            return result;
+        }
+        push([task]() {
+            (*task)();
+        });
+
+        return result;
+    }
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::function<void()> pop(const size_t index);
+    std::function<void()> steal(const size_t index);
+    std::function<void()> take(const size_t index);
+    void work(const size_t index);
+
+    // m_queues[0] is shared by all threads outside of the pool, worker i owns m_queues[i + 1]
+    std::vector<std::unique_ptr<queue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_pending = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+};
+
+// a set of jobs on a pool that can be waited for, wait() runs pending jobs of the pool until all
+// jobs of the group are done and rethrows the first exception of one of them
+class task_group {
+public:
+    explicit task_group(thread_pool& pool = thread_pool::shared()) : m_pool(pool) {}
+    ~task_group() {
+        m_pool.run_until([this]() {
+            return m_remaining == 0;
+        });
+    }
+    task_group(const task_group&) = delete;
+    void operator=(const task_group&) = delete;
+
+    template<typename exec_T>
+    void run(exec_T call) {
+        m_remaining++;
+        m_pool.push([this, call = std::move(call)]() {
+            try {
+                call();
+            } catch (...) {
+                std::unique_lock ul(m_mutex);
+                if (!m_error) {
+                    m_error = std::current_exception();
+                }
+            }
+            // the group may be gone as soon as the last job is done
+            auto& pool = m_pool;
+            if (--m_remaining == 0) {
+                pool.notify();
+            }
+        });
+    }
+    void wait() {
+        m_pool.run_until([this]() {
+            return m_remaining == 0;
+        });
+
+        std::exception_ptr error;
+        {
+            std::unique_lock ul(m_mutex);
+            std::swap(error, m_error);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+private:
+    thread_pool& m_pool;
+    std::atomic<size_t> m_remaining = 0;
+    std::mutex m_mutex;
+    std::exception_ptr m_error;
+};
+
+template<typename exec_T>
+    requires std::invocable<exec_T, size_t, size_t, size_t>
+void thread_pool::for_each_band(const size_t n, const exec_T& call) {
+    auto num_bands = bands(n);
+
+    if (num_bands == 1) {
+        call(0, 0, n);
+        return;
+    }
+
+    auto band_begin = [&](const size_t band) {
+        return (n * band) / num_bands;
+    };
+
+    task_group group(*this);
+    for (size_t band = 1; band < num_bands; band++) {
+        group.run([&, band]() {
+            call(band, band_begin(band), band_begin(band + 1));
+        });
+    }
+
+    call(0, band_begin(0), band_begin(1));
+    group.wait();
+}
+
+template<typename exec_T>
+    requires std::invocable<exec_T, size_t>
+void thread_pool::parallel_for(const size_t begin, const size_t end, const exec_T& call, const size_t grain) {
+    task_group group(*this);
+
+    // the upper half becomes a job, the lower half is split again by the current thread
+    auto split = [&](auto& self, size_t first, size_t last) -> void {
+        while (last - first > std::max<size_t>(1, grain) && concurrency() > 1) {
+            auto middle = first + (last - first) / 2;
+            group.run([&self, middle, last]() {
+                self(self, middle, last);
+            });
+            last = middle;
+        }
+        for (auto i = first; i < last; i++) {
+            call(i);
+        }
+    };
+
+    if (begin < end) {
+        split(split, begin, end);
+    }
+    group.wait();
+}
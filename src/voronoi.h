@@ -1,12 +1,42 @@
 #pragma once
 
-#include <iostream>
-#include <cassert>
 #include <set>
+#include <vector>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <utility>
+
+#include "label_image.h"
+#include "thread_pool.h"
+
+// a region of a voronoi diagram, the pixel count, bounding box and neighbours only cover labelled
+// pixels, the bounding box is inclusive and empty (min > max) for regions without pixels
+struct voronoi_region {
+    uint32_t id;
+    float x;
+    float y;
+    size_t pixels = 0;
+    int x_min = std::numeric_limits<int>::max();
+    int y_min = std::numeric_limits<int>::max();
+    int x_max = std::numeric_limits<int>::min();
+    int y_max = std::numeric_limits<int>::min();
+    // ids of the regions sharing an edge with one of the pixels, in ascending order
+    std::vector<uint32_t> neighbors;
+};
 
-#include "image.h"
+// labels plus the region table, regions[i] belongs to the label i + 1
+struct voronoi_diagram {
+    label_image labels;
+    std::vector<voronoi_region> regions;
+};
 
+// labels every pixel with the nearest sample: the samples are sorted by x and then y, sample i
+// gets the label i + 1, on equal distances the higher label wins
+// the samples are bucketed into a uniform grid of about one sample per cell, the pixels of a cell
+// only compare the samples of the surrounding rings of cells that can be nearest to one of them,
+// rows of cells run in parallel
 class voronoi_generator {
 public:
     bool contains(const float x, const float y) {
@@ -17,48 +47,58 @@ public:
             return;
         }
         m_sample_points.insert({x, y});
-        m_samples.push_back({.p = {x, y}});
+        m_samples.push_back({x, y});
     }
 
-    image<float> generate(const int width, const int height) {
-        image<float> result(width, height);
+    voronoi_diagram generate(const int width, const int height) {
+        return generate(width, height, [](const int x, const int y) {
+            return true;
+        });
+    }
+    // only labels the pixels for which active(x, y) is true, all others stay 0, cells without an
+    // active pixel are skipped entirely
+    template<typename F>
+    voronoi_diagram generate(const int width, const int height, const F& active) {
+        label_image result(width, height);
 
         std::sort(m_samples.begin(), m_samples.end(), [&](const auto& lhs, const auto& rhs) {
-            return lhs.p.x < rhs.p.x || (lhs.p.x == rhs.p.x && lhs.p.y < rhs.p.y);
+            return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
         });
-
-        //m_samples.clear();
-        //m_samples.push_back({.p = {49, 94}});
-        //m_samples.push_back({.p = {80, 170}});
-        //m_samples.push_back({.p = {88, 75}});
-        //m_samples.push_back({.p = {116, 133}});
-        for (int i = 0; i < m_samples.size(); i++) {
-            m_samples[i].soi.inequations.push_back({.a_x = 1, .a_y = 0, .t = 0});
-            m_samples[i].soi.inequations.push_back({.a_x = 0, .a_y = 1, .t = 0});
-            m_samples[i].soi.inequations.push_back({.a_x = -1, .a_y = 0, .t = static_cast<float>(width)});
-            m_samples[i].soi.inequations.push_back({.a_x = 0, .a_y = -1, .t = static_cast<float>(height)});
+        if (m_samples.empty() || width == 0 || height == 0) {
+            return {result, create_regions()};
         }
 
-        for (int i = 0; i < m_samples.size(); i++) {
-            for (int j = i + 1; j < m_samples.size(); j++) {
-                if (m_samples[i].check_and_update_range(m_samples[j], width, height)) {
-                    m_samples[i].create_edge_if_needed(m_samples[j]);
-                } else {
-                    auto dx = m_samples[j].p.x - m_samples[i].p.x;
-
-                    if (dx / 2 >= m_samples[i].scan_radius) {
-                        break;
+        grid g(m_samples, width, height);
+
+        // the pixels of a cell only compare the samples that can be nearest to any of them
+        thread_pool::shared().for_each_band(g.rows, [&](auto band, auto begin, auto end) {
+            std::vector<size_t> candidates;
+            for (int cy = begin; cy < end; cy++) {
+                int y_begin = cy * g.cell_size;
+                int y_end = std::min<int>(height, (cy + 1) * g.cell_size);
+                for (int cx = 0; cx < g.columns; cx++) {
+                    int x_begin = cx * g.cell_size;
+                    int x_end = std::min<int>(width, (cx + 1) * g.cell_size);
+                    bool found = false;
+
+                    for (int y = y_begin; y < y_end; y++) {
+                        auto row = result.row(y);
+                        for (int x = x_begin; x < x_end; x++) {
+                            if (!active(x, y)) {
+                                continue;
+                            }
+                            if (!found) {
+                                g.candidates(m_samples, x_begin, y_begin, x_end - 1, y_end - 1, candidates);
+                                found = true;
+                            }
+                            row[x] = nearest(candidates, x, y) + 1;
+                        }
                     }
                 }
             }
-        }
-
-        for (int i = 0; i < m_samples.size(); i++) {
-            auto c = i + 1; ////m_samples[i].size(result);
-            m_samples[i].paint_on_as(result, c, c);
-        }
+        });
 
-        return result;
+        return {result, measure_regions(result)};
     }
 
 private:
@@ -67,350 +107,226 @@ private:
         float y;
     };
 
-    static float distance(const point& a, const point& b) {
-       float dx = b.x - a.x;
-       float dy = b.y - a.y;
-       return sqrt(dx*dx + dy*dy);
-    }
-
-    static float diameter_to_edge(const float d) {
-       return d / sqrt(2.0f);
-    }
-
-    struct inequation {
-        float a_x;
-        float a_y;
-        float t;
-
-        bool satisfies(const point& p) const {
-            return a_x * p.x + a_y * p.y + t >= 0;
-        }
-        bool loose_satisfies(const point& p) const {
-            return a_x * p.x + a_y * p.y + t > -4;
-        }
-        float evaluate_on_x(const float x) const {
-            if (a_y == 1) {
-                return -a_x * x - t;
-            }
-            if (a_y == -1) {
-                return a_x * x + t;
-            }
-            return -1;
+    std::vector<voronoi_region> create_regions() const {
+        std::vector<voronoi_region> regions(m_samples.size());
+        for (size_t i = 0; i < m_samples.size(); i++) {
+            regions[i].id = i + 1;
+            regions[i].x = m_samples[i].x;
+            regions[i].y = m_samples[i].y;
         }
-        float evaluate_on_y(const float y) const {
-            assert(a_y != 0);
-            if (a_y == 1) {
-                return (y + t) / (-a_x);
-            }
-            if (a_y == -1) {
-                return (y - t) / a_x;
-            }
-            return -1;
-        }
-        inequation invert() const {
-            inequation copy = *this;
-            copy.a_x *= -1;
-            copy.a_y *= -1;
-            copy.t *= -1;
-            return copy;
-        }
-        point compute_crosspoint(const inequation& e2) const {
-            const inequation& e1 = *this;
-            bool e1_is_vertical = std::abs(e1.a_y) == 0;
-            bool e1_is_horizontal = std::abs(e1.a_x) == 0;
-            bool e2_is_vertical = std::abs(e2.a_y) == 0;
-            bool e2_is_horizontal = std::abs(e2.a_x) == 0;
-
-            if (e1_is_vertical && e2_is_vertical) {
-                return {-1, -1};
-            }
-            if (e1_is_vertical && !e2_is_vertical) {
-                point r;
-                r.x = std::abs(e1.t);
-                r.y = e2.evaluate_on_x(r.x);
-                return r;
-            }
-            if (!e1_is_vertical && e2_is_vertical) {
-                point r;
-                r.x = std::abs(e2.t);
-                r.y = e1.evaluate_on_x(r.x);
-                return r;
-            }
-            if (e1_is_horizontal && e2_is_horizontal) {
-                return {-1, -1};
-            }
-            if (e1_is_horizontal && !e2_is_horizontal) {
-                point r;
-                r.y = std::abs(e1.t);
-                r.x = e2.evaluate_on_y(r.y);
-                return r;
-            }
-            if (!e1_is_horizontal && e2_is_horizontal) {
-                point r;
-                r.y = std::abs(e2.t);
-                r.x = e1.evaluate_on_y(r.y);
-                return r;
-            }
-            if (e1_is_vertical && e2_is_horizontal) {
-                point r;
-                r.x = std::abs(e1.t);
-                r.y = std::abs(e2.t);
-                return r;
-            }
-            if (e1_is_horizontal && e2_is_vertical) {
-                point r;
-                r.x = std::abs(e2.t);
-                r.y = std::abs(e1.t);
-                return r;
-            }
-
-            auto normalized_e1 = e1;
-            auto normalized_e2 = e2;
 
-            if (normalized_e1.a_y > 0) {
-                normalized_e1 = normalized_e1.invert();
-            }
-            if (normalized_e2.a_y > 0) {
-                normalized_e2 = normalized_e2.invert();
-            }
-
-            point r;
-            r.x = (normalized_e2.t - normalized_e1.t) / (normalized_e1.a_x - normalized_e2.a_x);
-            r.y = normalized_e1.evaluate_on_x(r.x);
+        return regions;
+    }
 
-            return r;
-        }
-        bool are_parallel_and_more_strict(const inequation& e2) const {
-            const inequation& e1 = *this;
-            bool e1_is_vertical = e1.a_y == 0;
-            bool e1_is_horizontal = e1.a_x == 0;
-            bool e2_is_vertical = e2.a_y == 0;
-            bool e2_is_horizontal = e2.a_x == 0;
-
-            if (e1_is_vertical && e2_is_vertical) {
-                if (e1.a_x > 0 && e2.a_x > 0) {
-                    return e2.t > e1.t;
-                }
-                if (e1.a_x < 0 && e2.a_x < 0) {
-                    return e2.t < e1.t;
+    // one pass over the labels in row bands, every band counts into its own table and collects the
+    // label pairs across its right and lower pixel edges, the tables are merged afterwards
+    std::vector<voronoi_region> measure_regions(const label_image& labels) const {
+        auto& pool = thread_pool::shared();
+        auto height = labels.height();
+        auto width = labels.width();
+        std::vector<std::vector<voronoi_region>> band_regions(pool.bands(height));
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> band_edges(band_regions.size());
+
+        pool.for_each_band(height, [&](auto band, auto begin, auto end) {
+            auto& regions = band_regions[band];
+            auto& edges = band_edges[band];
+            regions.resize(m_samples.size());
+
+            auto add_edge = [&](const uint32_t a, const uint32_t b) {
+                if (a == 0 || b == 0 || a == b) {
+                    return;
                 }
-            }
-            if (e1_is_horizontal && e2_is_horizontal) {
-                if (e1.a_y > 0 && e2.a_y > 0) {
-                    return e2.t > e1.t;
+                std::pair<uint32_t, uint32_t> edge(std::min(a, b), std::max(a, b));
+                if (edges.empty() || edges.back() != edge) {
+                    edges.push_back(edge);
                 }
-                if (e1.a_y < 0 && e2.a_y < 0) {
-                    return e2.t < e1.t;
-                }
-            }
-
-            return false;
-        }
-    };
-
-    struct system_of_inequations {
-        std::vector<inequation> inequations;
-
-        bool cut_space_by(const inequation& e) const {
-            if (inequations.empty()) {
-                return true;
-            }
-
-            if (std::abs(e.a_x) == 0) {
-                //horizontal
-                for (int i = 0; i < inequations.size(); i++) {
-                    if (std::abs(inequations[i].a_x) != 0) {
+            };
+
+            for (size_t y = begin; y < end; y++) {
+                auto row = labels.row(y);
+                auto below = y + 1 < height ? labels.row(y + 1) : std::span<const uint32_t>();
+                for (size_t x = 0; x < width; x++) {
+                    auto label = row[x];
+                    if (label == 0) {
                         continue;
                     }
 
-                    if (e.a_y > 0 && inequations[i].a_y > 0 && e.t > inequations[i].t) {
-                        return false;
-                    }
-                    if (e.a_y < 0 && inequations[i].a_y < 0 && e.t > inequations[i].t) {
-                        return false;
-                    }
-                    if (e.a_y > 0 && inequations[i].a_y < 0 && (-e.t) > inequations[i].t) {
-                        return false;
-                    }
-                    if (e.a_y < 0 && inequations[i].a_y > 0 && e.t < (-inequations[i].t)) {
-                        return false;
-                    }
-                }
-            }
-            if (std::abs(e.a_y) == 0) {
-                //vertical
-                for (int i = 0; i < inequations.size(); i++) {
-                    if (std::abs(inequations[i].a_y) != 0) {
-                        continue;
-                    }
+                    auto& r = regions[label - 1];
+                    r.pixels++;
+                    r.x_min = std::min<int>(r.x_min, x);
+                    r.x_max = std::max<int>(r.x_max, x);
+                    r.y_min = std::min<int>(r.y_min, y);
+                    r.y_max = std::max<int>(r.y_max, y);
 
-                    if (e.a_x > 0 && inequations[i].a_x > 0 && e.t > inequations[i].t) {
-                        return false;
+                    if (x + 1 < width) {
+                        add_edge(label, row[x + 1]);
                     }
-                    if (e.a_x < 0 && inequations[i].a_x < 0 && e.t > inequations[i].t) {
-                        return false;
-                    }
-                    if (e.a_x > 0 && inequations[i].a_x < 0 && (-e.t) > inequations[i].t) {
-                        return false;
-                    }
-                    if (e.a_x < 0 && inequations[i].a_x > 0 && e.t < (-inequations[i].t)) {
-                        return false;
+                    if (!below.empty()) {
+                        add_edge(label, below[x]);
                     }
                 }
             }
 
-            for (int i = 0; i < inequations.size(); i++) {
-                if (std::abs(e.a_x) == 0 && std::abs(inequations[i].a_x) == 0) {
-                    continue;
-                }
-                if (std::abs(e.a_y) == 0 && std::abs(inequations[i].a_y) == 0) {
-                    continue;
-                }
-                auto cp = e.compute_crosspoint(inequations[i]);
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        });
 
-                bool success = true;
-                for (int j = 0; j < inequations.size(); j++) {
-                    if (i != j) {
-                        if (!inequations[j].loose_satisfies(cp)) {
-                            success = false;
-                        }
-                    }
-                }
-                if (success) {
-                    return true;
-                }
+        auto regions = create_regions();
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (size_t band = 0; band < band_regions.size(); band++) {
+            for (size_t i = 0; i < band_regions[band].size(); i++) {
+                const auto& from = band_regions[band][i];
+                auto& to = regions[i];
+                to.pixels += from.pixels;
+                to.x_min = std::min(to.x_min, from.x_min);
+                to.x_max = std::max(to.x_max, from.x_max);
+                to.y_min = std::min(to.y_min, from.y_min);
+                to.y_max = std::max(to.y_max, from.y_max);
             }
-
-            return false;
+            edges.insert(edges.end(), band_edges[band].begin(), band_edges[band].end());
         }
-        bool satisfies(const point& p) const {
-            for (const auto& e : inequations) {
-                if (!e.satisfies(p)) {
-                    return false;
-                }
-            }
 
-            return true;
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        for (auto [a, b] : edges) {
+            regions[a - 1].neighbors.push_back(b);
+            regions[b - 1].neighbors.push_back(a);
+        }
+        for (auto& r : regions) {
+            std::sort(r.neighbors.begin(), r.neighbors.end());
         }
 
-    };
-
-
-    struct sample {
-        system_of_inequations soi;
-        point p;
-        float scan_radius = std::numeric_limits<float>::max();
-
-        void paint_on_as(image<float>& img, const float color, const float mark) {
-            for (int y = std::max(0.0f, p.y - scan_radius); y <= std::min(static_cast<float>(img.height() - 1), p.y + scan_radius); y++) {
-                for (int x = std::max(0.0f, p.x - scan_radius); x <= std::min(static_cast<float>(img.width() - 1), p.x + scan_radius); x++) {
-                    if (soi.satisfies({static_cast<float>(x), static_cast<float>(y)})) {
-                        if (auto p = img.get(x, y)) {
-                            **p = color;
-                        }
-                    }
-                }
-            }
+        return regions;
+    }
 
-            img.at(p.x, p.y) = mark;
-        }
-        size_t size(image<float>& img) const {
-            size_t result = 0;
-            for (int y = std::max(0.0f, p.y - scan_radius); y <= std::min(static_cast<float>(img.height() - 1), p.y + scan_radius); y++) {
-                for (int x = std::max(0.0f, p.x - scan_radius); x <= std::min(static_cast<float>(img.width() - 1), p.x + scan_radius); x++) {
-                    if (soi.satisfies({static_cast<float>(x), static_cast<float>(y)})) {
-                        result++;
-                    }
-                }
+    size_t nearest(const std::vector<size_t>& candidates, const float x, const float y) const {
+        size_t best = 0;
+        double best_distance = std::numeric_limits<double>::infinity();
+
+        // squared distances in double are exact for integer positions, so ties are decided by label
+        for (auto i : candidates) {
+            double dx = m_samples[i].x - x;
+            double dy = m_samples[i].y - y;
+            double d = dx * dx + dy * dy;
+            if (d < best_distance || (d == best_distance && i > best)) {
+                best = i;
+                best_distance = d;
             }
-
-            return result;
         }
 
-        inequation separation_line(const point& p2) const {
-            const auto& p1 = p;
-            point mid = {.x = (p1.x + p2.x) / 2.0f, .y = (p1.y + p2.y) / 2.0f};
-
-            auto dx = mid.x - p1.x;
-            auto dy = mid.y - p1.y;
+        return best;
+    }
 
-            assert(dx != 0 || dy != 0);
+    struct grid {
+        grid(const std::vector<point>& samples, const int width, const int height) {
+            cell_size = std::max(1.0, std::ceil(std::sqrt(static_cast<double>(width) * height / samples.size())));
+            columns = std::ceil(width / cell_size);
+            rows = std::ceil(height / cell_size);
 
-            if (dx == 0) {
-                inequation result = {.a_x = 0, .a_y = -1, .t = mid.y};
-                if (dy > 0) {
-                    return result;
-                } else {
-                    return result.invert();
-                }
+            // samples of cell c are cell_samples[cell_begin[c]] to cell_samples[cell_begin[c + 1] - 1]
+            cell_begin.assign(columns * rows + 1, 0);
+            for (const auto& s : samples) {
+                cell_begin[cell_of(s) + 1]++;
             }
-
-            if (dy == 0) {
-                inequation result = {.a_x = -1, .a_y = 0, .t = mid.x};
-                if (dx > 0) {
-                    return result;
-                } else {
-                    return result.invert();
-                }
+            for (size_t c = 0; c < columns * rows; c++) {
+                cell_begin[c + 1] += cell_begin[c];
             }
-
-            auto m = -dx / dy;
-            auto t = mid.y - m * mid.x;
-
-            inequation result = {.a_x = m, .a_y = -1, .t = t};
-            if (dy > 0) {
-                return result;
-            } else {
-                return result.invert();
+            cell_samples.resize(samples.size());
+            auto next = cell_begin;
+            for (size_t i = 0; i < samples.size(); i++) {
+                cell_samples[next[cell_of(samples[i])]++] = i;
             }
         }
 
-        bool check_and_update_range(const sample& other, const int width, const int height) {
-            auto d = distance(p, other.p);
-            auto e = diameter_to_edge(d) / 2;
-
-            //std::cout << "\t" << e << std::endl;
+        int column_of(const float x) const {
+            return std::clamp(static_cast<int>(x / cell_size), 0, columns - 1);
+        }
+        int row_of(const float y) const {
+            return std::clamp(static_cast<int>(y / cell_size), 0, rows - 1);
+        }
+        size_t cell_of(const point& p) const {
+            return row_of(p.y) * columns + column_of(p.x);
+        }
 
-            if (e >= scan_radius) {
-                return false;
+        // collects the samples that can be nearest to a pixel of the rectangle: every pixel has a
+        // sample within the distance of the center's nearest sample plus half the diagonal
+        void candidates(const std::vector<point>& samples, const float x_min, const float y_min, const float x_max, const float y_max, std::vector<size_t>& result) const {
+            float center_x = (x_min + x_max) / 2;
+            float center_y = (y_min + y_max) / 2;
+            float half_diagonal = std::hypot(x_max - x_min, y_max - y_min) / 2;
+            int cx = column_of(center_x);
+            int cy = row_of(center_y);
+
+            auto for_each_in_ring = [&](const int r, const auto& call) {
+                auto visit = [&](const int column, const int row) {
+                    if (column < 0 || column >= columns || row < 0 || row >= rows) {
+                        return;
+                    }
+                    auto c = row * columns + column;
+                    for (auto k = cell_begin[c]; k < cell_begin[c + 1]; k++) {
+                        call(cell_samples[k]);
+                    }
+                };
+                if (r == 0) {
+                    visit(cx, cy);
+                    return;
+                }
+                for (int k = -r; k <= r; k++) {
+                    visit(cx + k, cy - r);
+                    visit(cx + k, cy + r);
+                }
+                for (int k = -r + 1; k < r; k++) {
+                    visit(cx - r, cy + k);
+                    visit(cx + r, cy + k);
+                }
+            };
+            // every sample outside of ring r is at least this far away from the point
+            auto gap = [&](const int r, const float x, const float y) {
+                return std::min({
+                    x - (cx - r) * cell_size,
+                    (cx + r + 1) * cell_size - x,
+                    y - (cy - r) * cell_size,
+                    (cy + r + 1) * cell_size - y
+                });
+            };
+            int max_ring = std::max(columns, rows);
+
+            // distance from the center to its nearest sample
+            double nearest = std::numeric_limits<double>::infinity();
+            for (int r = 0; r <= max_ring; r++) {
+                for_each_in_ring(r, [&](const size_t i) {
+                    nearest = std::min(nearest, std::hypot<double>(samples[i].x - center_x, samples[i].y - center_y));
+                });
+                if (gap(r, center_x, center_y) > nearest) {
+                    break;
+                }
             }
 
-            inequation left = {.a_x = 1, .a_y = 0, .t = -(p.x - e)};
-            inequation right = {.a_x = -1, .a_y = 0, .t = p.x + e};
-            inequation top = {.a_x = 0, .a_y = -1, .t = p.y + e};
-            inequation bot = {.a_x = 0, .a_y = 1, .t = -(p.y - e)};
-
-            if ( 
-                (std::abs(left.t) >= 0 && soi.cut_space_by(left)) ||
-                (std::abs(right.t) < width && soi.cut_space_by(right)) ||
-                (std::abs(top.t) < height && soi.cut_space_by(top)) ||
-                (std::abs(bot.t) >= 0 && soi.cut_space_by(bot))
-            ) {
-                //std::cout << "\t" << (std::abs(left.t) >= 0 && soi.cut_space_by(left)) << " ";
-                //std::cout << (std::abs(right.t) < width && soi.cut_space_by(right)) << " ";
-                //std::cout << (std::abs(top.t) < height && soi.cut_space_by(top)) << " ";
-                //std::cout << (std::abs(bot.t) >= 0 && soi.cut_space_by(bot)) << std::endl;
-                return true;
-            } else {
-                scan_radius = e;
-
-                return false;
+            // the rectangle lies within its center's cell block, so rings are bounded the same way,
+            // the slack keeps the nearest sample when the rounded square root is slightly too small
+            double reach = nearest + half_diagonal + 1e-3;
+            result.clear();
+            for (int r = 0; r <= max_ring; r++) {
+                for_each_in_ring(r, [&](const size_t i) {
+                    double dx = std::max({x_min - samples[i].x, 0.0f, samples[i].x - x_max});
+                    double dy = std::max({y_min - samples[i].y, 0.0f, samples[i].y - y_max});
+                    if (dx * dx + dy * dy <= reach * reach) {
+                        result.push_back(i);
+                    }
+                });
+                if (gap(r, center_x, center_y) - half_diagonal > reach) {
+                    break;
+                }
             }
         }
 
-        void create_edge_if_needed(sample& other) {
-            auto s1_s2 = separation_line(other.p);
-            auto s2_s1 = s1_s2.invert();
-
-            if (soi.cut_space_by(s1_s2)) {
-                soi.inequations.push_back(s1_s2);
-            }
-            if (other.soi.cut_space_by(s2_s1)) {
-                other.soi.inequations.push_back(s2_s1);
-            }
-        }
+        double cell_size;
+        int columns;
+        int rows;
+        std::vector<size_t> cell_begin;
+        std::vector<size_t> cell_samples;
     };
 
-   std::vector<sample> m_samples; 
-   std::set<std::pair<float, float>> m_sample_points;
+    std::vector<point> m_samples;
+    std::set<std::pair<float, float>> m_sample_points;
 };
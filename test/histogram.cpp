@@ -0,0 +1,57 @@
+#include <vector>
+
+#include "check.h"
+#include "helper.h"
+#include "image_expression.h"
+
+namespace {
+
+std::vector<size_t> bins_of(const std::vector<float>& values, const expression::histogram<float>& reducer) {
+    image<float> img(values.size(), 1, image_init::uninitialized);
+    for (size_t i = 0; i < values.size(); i++) {
+        img.at(i, 0) = values[i];
+    }
+
+    return expression::reduce(execution::seq, img, reducer);
+}
+
+}
+
+int main() {
+    // every bin is [low + i * w, low + (i + 1) * w), only high itself joins the last one
+    CHECK((bins_of({0.0f, 0.2499f, 0.25f, 0.4999f, 0.5f, 0.7499f, 0.75f, 0.9999f, 1.0f}, {4, 0.0f, 1.0f}) == std::vector<size_t>{2, 2, 2, 3}));
+    CHECK((bins_of({2.0f, 2.999f, 3.0f, 4.0f, 5.0f, 5.999f, 6.0f}, {4, 2.0f, 6.0f}) == std::vector<size_t>{2, 1, 1, 3}));
+    // values outside of [low, high] are skipped
+    CHECK((bins_of({-0.5f, -0.0001f, 1.0001f, 2.0f}, {4, 0.0f, 1.0f}) == std::vector<size_t>{0, 0, 0, 0}));
+
+    // a parallel reduction counts the same as the sequential one
+    image<float> img(1000, 700, image_init::uninitialized);
+    random_stream stream(1);
+    img.for_each_pixel([&](float& p) {
+        p = uniform_float(stream(), -0.1f, 1.1f);
+    });
+    expression::histogram<float> reducer{256, 0.0f, 1.0f};
+    auto parallel = expression::reduce(execution::par, img, reducer);
+    std::vector<size_t> expected(256, 0);
+    img.for_each_pixel([&](float p) {
+        if (p >= 0.0f && p <= 1.0f) {
+            expected[std::min<size_t>(p * 256, 255)]++;
+        }
+    });
+    CHECK(parallel == expected);
+
+    // the grayscale histogram keeps the bins p * 255
+    image<float> gray(5, 1, image_init::uninitialized);
+    float values[] = {0.0f, 0.5f, 254.5f / 255.0f, 1.0f, 1.5f};
+    for (int i = 0; i < 5; i++) {
+        gray.at(i, 0) = values[i];
+    }
+    auto histogram = generate_grayscale_histogram(gray);
+    CHECK(histogram.size() == 256);
+    CHECK(histogram[0] == 1);
+    CHECK(histogram[127] == 1);
+    CHECK(histogram[254] == 1);
+    CHECK(histogram[255] == 1);
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <utility>
+
+#include "check.h"
+#include "image.h"
+
+namespace {
+
+image<float> numbered(const int width, const int height) {
+    image<float> img(width, height, image_init::uninitialized);
+    img.for_each_pixel([](float& p, auto x, auto y) {
+        p = y * 100 + x;
+    });
+
+    return img;
+}
+
+}
+
+int main() {
+    // a copy of the parent taken after the view does not see writes through the view
+    {
+        auto parent = numbered(8, 6);
+        auto view = parent.subregion(2, 1, 4, 3);
+        CHECK(view);
+        auto copy = parent;
+        view->at(0, 0) = -1.0f;
+        CHECK(parent.at(2, 1) == -1.0f);
+        CHECK(std::as_const(copy).at(2, 1) == 102.0f);
+
+        // the view and the parent still share their pixels
+        parent.at(3, 2) = -2.0f;
+        CHECK(std::as_const(*view).at(1, 1) == -2.0f);
+        CHECK(std::as_const(copy).at(3, 2) == 203.0f);
+    }
+    // the same for a copy assigned to an existing image and for copies of the view
+    {
+        auto parent = numbered(8, 6);
+        auto view = parent.subregion(0, 0, 8, 6);
+        image<float> copy(1, 1);
+        copy = parent;
+        auto view_copy = *view;
+        view->at(5, 5) = -1.0f;
+        CHECK(std::as_const(copy).at(5, 5) == 505.0f);
+        CHECK(std::as_const(view_copy).at(5, 5) == 505.0f);
+        view_copy.at(4, 4) = -3.0f;
+        CHECK(parent.at(4, 4) == 404.0f);
+    }
+    // copies taken before the view are detached from it
+    {
+        auto parent = numbered(8, 6);
+        auto copy = parent;
+        auto view = parent.subregion(1, 1, 2, 2);
+        view->at(0, 0) = -1.0f;
+        CHECK(parent.at(1, 1) == -1.0f);
+        CHECK(std::as_const(copy).at(1, 1) == 101.0f);
+    }
+    // a subregion of a const image is copied on its first write
+    {
+        const auto parent = numbered(8, 6);
+        auto copy = parent;
+        auto region = parent.subregion(2, 2, 3, 3);
+        region->at(0, 0) = -1.0f;
+        CHECK(parent.at(2, 2) == 202.0f);
+        CHECK(std::as_const(copy).at(2, 2) == 202.0f);
+        CHECK(std::as_const(*region).at(1, 1) == 303.0f);
+    }
+    // a const subregion of an image with a view does not follow the later writes of the view
+    {
+        auto parent = numbered(8, 6);
+        auto view = parent.subregion(0, 0, 4, 4);
+        auto region = std::as_const(parent).subregion(0, 0, 4, 4);
+        view->at(1, 1) = -1.0f;
+        CHECK(parent.at(1, 1) == -1.0f);
+        CHECK(std::as_const(*region).at(1, 1) == 101.0f);
+    }
+
+    return 0;
+}
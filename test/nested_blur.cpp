@@ -0,0 +1,62 @@
+#include <optional>
+#include <vector>
+
+#include "check.h"
+#include "helper.h"
+#include "thread_pool.h"
+
+namespace {
+
+// images of a few different sizes, so nested blurs also differ in size from the outer ones
+std::vector<image<float>> inputs() {
+    std::vector<image<float>> result;
+    random_stream stream(21);
+    for (int i = 0; i < 16; i++) {
+        int size = 1024 + 256 * (i % 3);
+        image<float> img(size, size, image_init::uninitialized);
+        img.for_each_pixel([&](float& p) {
+            p = uniform_float(stream(), 0.0f, 1.0f);
+        });
+        result.push_back(img);
+    }
+
+    return result;
+}
+
+void blur(image<float>& img) {
+    add_gaussian_blur(img);
+    add_gaussian_blur(img, 5);
+    add_gaussian_blur(img);
+}
+
+}
+
+// blurs run inside jobs of parallel_for, so a thread waiting for the bands of its blur picks up
+// whole blurs of other images, the results have to match blurring one image after the other
+int main() {
+    thread_pool::configure(1);
+    auto expected = inputs();
+    for (auto& img : expected) {
+        blur(img);
+    }
+
+    for (size_t threads : {2, 4, 8, 16}) {
+        thread_pool::configure(threads);
+        for (int run = 0; run < 3; run++) {
+            auto images = inputs();
+            thread_pool::shared().parallel_for(0, images.size(), [&](size_t i) {
+                blur(images[i]);
+            });
+
+            for (size_t i = 0; i < images.size(); i++) {
+                bool equal = true;
+                images[i].for_each_pixel([&](float p, size_t x, size_t y) {
+                    equal = equal && p == expected[i].at(x, y);
+                });
+                CHECK(equal);
+            }
+        }
+    }
+
+    return 0;
+}
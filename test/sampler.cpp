@@ -0,0 +1,68 @@
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "random_generator.h"
+#include "sampler.h"
+
+int main() {
+    // a long run of weights set to 0 leaves no residue in the total, draws only hit pixels that
+    // are left and find them without scanning the run
+    {
+        const size_t width = 1000;
+        const size_t height = 1000;
+        random_stream stream(7);
+        // weights of very different magnitudes do not sum up exactly
+        weighted_pixel_sampler sampler(width, height, [&](auto x, auto y) {
+            auto w = uniform_float(stream.at(y * width + x), 0.5f, 1.0f);
+            return (x + y) % 13 == 0 ? w * 1e6f : std::ldexp(w, -static_cast<int>(x % 40));
+        });
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                if (y != 500 || x % 100 != 0) {
+                    sampler.set_weight(x, y, 0.0f);
+                }
+            }
+        }
+
+        double left = 0;
+        for (size_t x = 0; x < width; x += 100) {
+            left += sampler.weight(x, 500);
+        }
+        CHECK(sampler.total() == left);
+
+        std::vector<int> hits(10, 0);
+        for (int i = 0; i < 10000; i++) {
+            auto p = sampler.draw(uniform_float(stream(), 0.0f, 1.0f));
+            CHECK(p);
+            CHECK(p->second == 500 && p->first % 100 == 0);
+            hits[p->first / 100]++;
+        }
+        for (size_t x = 0; x < width; x += 100) {
+            auto expected = 10000 * sampler.weight(x, 500) / left;
+            CHECK(hits[x / 100] > expected * 0.8 - 30 && hits[x / 100] < expected * 1.2 + 30);
+        }
+        // u just below 1 still ends on the last pixel that is left
+        CHECK((sampler.draw(0.9999999999999999) == std::pair<int, int>(900, 500)));
+    }
+    // all weights set to 0 after being non zero
+    {
+        weighted_pixel_sampler sampler(33, 17, [](auto x, auto y) {
+            return 0.1f * (x + 1) + 0.37f * y;
+        });
+        for (int y = 0; y < 17; y++) {
+            for (int x = 0; x < 33; x++) {
+                sampler.set_weight(x, y, 0.0f);
+            }
+        }
+        CHECK(sampler.total() == 0.0);
+        CHECK(!sampler.draw(0.5));
+        CHECK(!sampler.draw(0.0));
+
+        sampler.set_weight(32, 16, 0.25f);
+        CHECK((sampler.draw(0.0) == std::pair<int, int>(32, 16)));
+        CHECK((sampler.draw(0.9999999999999999) == std::pair<int, int>(32, 16)));
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "random_generator.h"
+#include "voronoi.h"
+
+namespace {
+
+// labels the border pixels and random inner pixels of a random diagram and compares them with a
+// brute force search, ties go to the higher label
+void check_nearest(const int size, const int sites, const uint64_t seed) {
+    voronoi_generator generator;
+    std::vector<std::pair<float, float>> samples;
+    random_stream stream(seed);
+    while (static_cast<int>(samples.size()) < sites) {
+        float x = stream() % size;
+        float y = stream() % size;
+        if (!generator.contains(x, y)) {
+            generator.add(x, y);
+            samples.push_back({x, y});
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    auto diagram = generator.generate(size, size);
+
+    auto check_pixel = [&](const int x, const int y) {
+        size_t best = 0;
+        double best_distance = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < samples.size(); i++) {
+            double dx = samples[i].first - x;
+            double dy = samples[i].second - y;
+            double d = dx * dx + dy * dy;
+            if (d < best_distance || (d == best_distance && i > best)) {
+                best = i;
+                best_distance = d;
+            }
+        }
+        CHECK(diagram.labels.at(x, y) == best + 1);
+    };
+
+    for (int i = 0; i < size; i++) {
+        check_pixel(i, 0);
+        check_pixel(i, size - 1);
+        check_pixel(0, i);
+        check_pixel(size - 1, i);
+    }
+    for (int i = 0; i < 2000; i++) {
+        check_pixel(stream() % size, stream() % size);
+    }
+}
+
+}
+
+int main() {
+    check_nearest(64, 1, 1);
+    check_nearest(64, 2, 2);
+    check_nearest(256, 300, 3);
+    // the cells of 11 pixels leave a last column and row of cells one pixel wide
+    check_nearest(1024, 10000, 1024 * 31 + 10000);
+
+    return 0;
+}